@@ -0,0 +1,247 @@
+// https://docs.espressif.com/projects/esp-idf/en/stable/esp32/api-reference/peripherals/gpio.html
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "freertos/task.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "driver/gpio.h"
+
+#include "pin.h"
+#include "buttons.h"
+
+// Each edge interrupt compares the pins with the debounced state. The
+// first edge of a change is taken at once, so a press is reported with
+// interrupt latency, and later edges of that button are ignored for the
+// debounce time. The button task looks at the pins again when the
+// debounce time is over, to catch a change hidden by it, and makes the
+// long press and repeat events. The queue is fed from both.
+
+#define TASK_STACK 2048
+#define TASK_PRIO 5
+#define US_PER_MS 1000
+
+#define PIN_GET_BIT(r,b) (((r) >> (b)) & 1)
+
+static const char *TAG = "buttons";
+
+typedef struct {
+	pin_num_t pin;
+	bool down;       // Debounced state
+	bool held;       // Long press event was made
+	int64_t lock_us; // Edges are ignored until this time
+	int64_t next_us; // Time of the next long or repeat event, zero if none
+} btn_t;
+
+static btn_t btn[BUTTONS_MAX];
+static uint32_t btn_num;
+static QueueHandle_t queue;
+static TaskHandle_t task;
+static portMUX_TYPE lock = portMUX_INITIALIZER_UNLOCKED;
+static uint64_t state; // Debounced state, a bit per pin
+static volatile uint32_t dropped;
+
+static uint32_t debounce_us = BUTTONS_DEBOUNCE_MS*US_PER_MS;
+static uint32_t long_us = BUTTONS_LONG_MS*US_PER_MS;
+static uint32_t repeat_us = BUTTONS_REPEAT_MS*US_PER_MS;
+
+
+// Compare the pins with the debounced state and make an event for each
+// change outside of the debounce time, and for each long press or repeat
+// that is due. Called with the lock held.
+// now: current time in us.
+// *ev: set to the events made, room for BUTTONS_MAX.
+// Return the number of events made.
+static uint32_t btn_scan(int64_t now, buttons_event_t *ev)
+{
+	uint64_t in = pin_get_in_reg();
+	uint32_t n = 0;
+
+	for (uint32_t i = 0; i < btn_num; i++) {
+		btn_t *b = btn+i;
+		bool down = !PIN_GET_BIT(in, b->pin); // Active low
+		if (down != b->down && now >= b->lock_us) {
+			b->down = down;
+			b->held = false;
+			b->lock_us = now + debounce_us;
+			b->next_us = (down && long_us) ? now + long_us : 0;
+			state ^= 1LLU << b->pin;
+			ev[n++] = (buttons_event_t){now, b->pin, down ? BUTTONS_PRESS : BUTTONS_RELEASE};
+		} else if (b->next_us && now >= b->next_us) {
+			ev[n++] = (buttons_event_t){now, b->pin, b->held ? BUTTONS_REPEAT : BUTTONS_LONG};
+			b->held = true;
+			b->next_us = repeat_us ? now + repeat_us : 0;
+		}
+	}
+	return n;
+}
+
+// Return the earliest time the button task must scan again, or zero if
+// there is nothing to wait for. Called with the lock held.
+// now: current time in us.
+static int64_t btn_next(int64_t now)
+{
+	int64_t next = 0;
+
+	for (uint32_t i = 0; i < btn_num; i++) {
+		btn_t *b = btn+i;
+		if (b->lock_us > now && (!next || b->lock_us < next)) next = b->lock_us;
+		if (b->next_us && (!next || b->next_us < next)) next = b->next_us;
+	}
+	return next;
+}
+
+// Edge interrupt handler for all button pins.
+static void btn_isr(void *arg)
+{
+	buttons_event_t ev[BUTTONS_MAX];
+	BaseType_t woken = pdFALSE;
+	uint32_t n;
+
+	portENTER_CRITICAL_ISR(&lock);
+	n = btn_scan(esp_timer_get_time(), ev);
+	portEXIT_CRITICAL_ISR(&lock);
+	for (uint32_t i = 0; i < n; i++)
+		if (xQueueSendFromISR(queue, ev+i, &woken) != pdTRUE) dropped++;
+	vTaskNotifyGiveFromISR(task, &woken); // Scan after the debounce time
+	if (woken) portYIELD_FROM_ISR();
+}
+
+// Button task. Sleeps until the next debounce time, long press or repeat
+// is due, or until woken by an edge.
+static void btn_task(void *arg)
+{
+	buttons_event_t ev[BUTTONS_MAX];
+	int64_t now, next;
+	uint32_t n;
+
+	for (;;) {
+		now = esp_timer_get_time();
+		taskENTER_CRITICAL(&lock);
+		n = btn_scan(now, ev);
+		next = btn_next(now);
+		taskEXIT_CRITICAL(&lock);
+		for (uint32_t i = 0; i < n; i++)
+			if (xQueueSend(queue, ev+i, 0) != pdTRUE) dropped++;
+		ulTaskNotifyTake(pdTRUE, next ?
+			pdMS_TO_TICKS((next-now+US_PER_MS-1)/US_PER_MS)+1 : portMAX_DELAY);
+	}
+}
+
+// Initialize the button driver. The pins are configured as inputs with
+// pull-ups, and an interrupt on either edge reports each change. Buttons
+// are active low. Must be called before using buttons.
+// mask: bit mask of the button pins, e.g., HW_BTN_MASK.
+// Return zero if successful, or non-zero otherwise.
+int32_t buttons_init(uint64_t mask)
+{
+	esp_err_t err;
+
+	if (queue != NULL) buttons_deinit();
+	btn_num = 0;
+	state = 0;
+	dropped = 0;
+	for (pin_num_t p = 0; p < GPIO_NUM_MAX; p++) {
+		if (!((mask >> p) & 1)) continue;
+		if (btn_num >= BUTTONS_MAX) {
+			ESP_LOGE(TAG, "too many buttons");
+			return -1;
+		}
+		btn[btn_num++] = (btn_t){.pin = p};
+	}
+	if (pin_config_mask(mask, PIN_INPUT | PIN_PULLUP)) return -1;
+
+	queue = xQueueCreate(BUTTONS_QUEUE_LEN, sizeof(buttons_event_t));
+	if (queue == NULL) return -1;
+	if (xTaskCreate(btn_task, TAG, TASK_STACK, NULL, TASK_PRIO, &task) != pdPASS) {
+		vQueueDelete(queue);
+		queue = NULL;
+		return -1;
+	}
+
+	// The service may already be installed by another driver
+	err = gpio_install_isr_service(0);
+	if (err != ESP_OK && err != ESP_ERR_INVALID_STATE) {
+		ESP_LOGE(TAG, "gpio_install_isr_service: %s", esp_err_to_name(err));
+		buttons_deinit();
+		return -1;
+	}
+	for (uint32_t i = 0; i < btn_num; i++) {
+		gpio_set_intr_type(btn[i].pin, GPIO_INTR_ANYEDGE);
+		gpio_isr_handler_add(btn[i].pin, btn_isr, NULL);
+		gpio_intr_enable(btn[i].pin);
+	}
+	xTaskNotifyGive(task); // Take the state of buttons already down
+	return 0;
+}
+
+// Free resources used by the button driver (interrupts, task and queue).
+// Return zero if successful, or non-zero otherwise.
+int32_t buttons_deinit(void)
+{
+	if (queue == NULL) return -1;
+	for (uint32_t i = 0; i < btn_num; i++) {
+		gpio_intr_disable(btn[i].pin);
+		gpio_isr_handler_remove(btn[i].pin);
+	}
+	btn_num = 0;
+	vTaskDelete(task);
+	task = NULL;
+	vQueueDelete(queue);
+	queue = NULL;
+	return 0;
+}
+
+// Set the timing used to make events. Changes take effect with the next
+// edge of each button.
+// debounce_ms: time a change must last before the next is accepted.
+// long_ms: time held down before a long press event, zero for none.
+// repeat_ms: time between repeat events after long, zero for none.
+void buttons_set_timing(uint32_t debounce_ms, uint32_t long_ms, uint32_t repeat_ms)
+{
+	taskENTER_CRITICAL(&lock);
+	debounce_us = debounce_ms*US_PER_MS;
+	long_us = long_ms*US_PER_MS;
+	repeat_us = repeat_ms*US_PER_MS;
+	taskEXIT_CRITICAL(&lock);
+}
+
+// Get the next button event from the queue.
+// *ev: set to the event.
+// wait_ms: time to wait for an event, zero to return at once.
+// Return true if an event was received, otherwise false.
+bool buttons_get(buttons_event_t *ev, uint32_t wait_ms)
+{
+	if (queue == NULL || ev == NULL) return false;
+	return xQueueReceive(queue, ev, pdMS_TO_TICKS(wait_ms)) == pdTRUE;
+}
+
+// Get the press events waiting in the queue. Other events are dropped.
+// Return a bit mask of the pins pressed since the last call, like
+// pin_get_in_reg() but one-shot and active high.
+uint64_t buttons_pressed(void)
+{
+	buttons_event_t ev;
+	uint64_t mask = 0;
+
+	while (buttons_get(&ev, 0))
+		if (ev.type == BUTTONS_PRESS) mask |= 1LLU << ev.pin;
+	return mask;
+}
+
+// Return a bit mask of the pins held down after debouncing.
+uint64_t buttons_state(void)
+{
+	uint64_t s;
+
+	taskENTER_CRITICAL(&lock); // Two words on a 32-bit CPU
+	s = state;
+	taskEXIT_CRITICAL(&lock);
+	return s;
+}
+
+// Return the number of events dropped because the queue was full.
+uint32_t buttons_dropped(void)
+{
+	return dropped;
+}
@@ -0,0 +1,65 @@
+#ifndef BUTTONS_H_
+#define BUTTONS_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "pin.h" // pin_num_t
+
+#define BUTTONS_MAX 8 // Buttons that can be watched
+#define BUTTONS_QUEUE_LEN 16 // Events that can wait in the queue
+
+// Default timing, see buttons_set_timing()
+#define BUTTONS_DEBOUNCE_MS 20
+#define BUTTONS_LONG_MS 500
+#define BUTTONS_REPEAT_MS 100
+
+typedef enum {
+	BUTTONS_PRESS,   // Button went down
+	BUTTONS_RELEASE, // Button went up
+	BUTTONS_LONG,    // Button held down for the long press time
+	BUTTONS_REPEAT,  // Button still held, once per repeat time after long
+} buttons_type_t;
+
+typedef struct {
+	int64_t time_us;     // Time of the event (esp_timer_get_time())
+	pin_num_t pin;       // Button I/O pin, e.g., HW_BTN_A
+	buttons_type_t type;
+} buttons_event_t;
+
+// Initialize the button driver. The pins are configured as inputs with
+// pull-ups, and an interrupt on either edge reports each change. Buttons
+// are active low. Must be called before using buttons.
+// mask: bit mask of the button pins, e.g., HW_BTN_MASK.
+// Return zero if successful, or non-zero otherwise.
+int32_t buttons_init(uint64_t mask);
+
+// Free resources used by the button driver (interrupts, task and queue).
+// Return zero if successful, or non-zero otherwise.
+int32_t buttons_deinit(void);
+
+// Set the timing used to make events. Changes take effect with the next
+// edge of each button.
+// debounce_ms: time a change must last before the next is accepted.
+// long_ms: time held down before a long press event, zero for none.
+// repeat_ms: time between repeat events after long, zero for none.
+void buttons_set_timing(uint32_t debounce_ms, uint32_t long_ms, uint32_t repeat_ms);
+
+// Get the next button event from the queue.
+// *ev: set to the event.
+// wait_ms: time to wait for an event, zero to return at once.
+// Return true if an event was received, otherwise false.
+bool buttons_get(buttons_event_t *ev, uint32_t wait_ms);
+
+// Get the press events waiting in the queue. Other events are dropped.
+// Return a bit mask of the pins pressed since the last call, like
+// pin_get_in_reg() but one-shot and active high.
+uint64_t buttons_pressed(void);
+
+// Return a bit mask of the pins held down after debouncing.
+uint64_t buttons_state(void);
+
+// Return the number of events dropped because the queue was full.
+uint32_t buttons_dropped(void);
+
+#endif // BUTTONS_H_
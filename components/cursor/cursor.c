@@ -1,16 +1,13 @@
 
-#include <stdlib.h> // abs
-
 #include "joy.h"
 #include "cursor.h"
 
 #define SEN_DEFAULT 1.25f // Screen widths per second
-#define THRESH_DEFAULT 0.75f // Raw ADC values
+#define THRESH_DEFAULT 0.075f // Factor of maximum displacement
 #define CLIP(x,lo,hi) ((x) < (lo) ? (lo) : ((x) > (hi) ? (hi) : (x)))
 
 static uint32_t uperiod; // Update period in milliseconds.
 static float sfactor; // Joystick sensitivity factor.
-static uint32_t thresh; // Joystick displacement threshold.
 static float xpos, ypos; // Current cursor position as a float.
 
 
@@ -37,16 +34,26 @@ int32_t cursor_init(uint32_t per)
 // Therefore, it must be called from a software task context.
 void cursor_tick(void)
 {
-	int32_t dcx, dcy;
+	float dx, dy;
+
+	// Get filtered joystick displacement with dead zone and response curve.
+	joy_get_shaped(&dx, &dy);
+	cursor_move(dx, dy);
+}
 
-	// Get joystick position relative to the center in raw ADC values.
-	joy_get_displacement(&dcx, &dcy);
-	if (abs(dcx) < thresh && abs(dcy) < thresh) return;
+// Move the cursor by a joystick displacement, as cursor_tick() does with
+// the displacement read from the joystick. Used when the joystick is
+// read elsewhere, e.g., by an input layer that records and replays it.
+// dx: displacement from -1.0 (left) to 1.0 (right).
+// dy: displacement from -1.0 (up) to 1.0 (down).
+void cursor_move(float dx, float dy)
+{
+	if (dx == 0.0f && dy == 0.0f) return;
 
 	// Based on the joystick position relative to center,
 	// calculate a new position for the cursor.
-	xpos += dcx*sfactor;
-	ypos += dcy*sfactor;
+	xpos += dx*sfactor;
+	ypos += dy*sfactor;
 
 	// Clip new position to screen.
 	xpos = CLIP(xpos, 0, LCD_W-1);
@@ -60,7 +67,7 @@ void cursor_tick(void)
 void cursor_set_sensitivity(float sens)
 {
 	float rate = sens*LCD_W; // Convert to pixels per second
-	sfactor = ((rate < 1.0f) ? 1.0f : rate) / JOY_MAX_DISP * uperiod / 1000;
+	sfactor = ((rate < 1.0f) ? 1.0f : rate) * uperiod / 1000;
 }
 
 // Set the threshold of joystick displacement needed before moving the cursor.
@@ -70,7 +77,7 @@ void cursor_set_sensitivity(float sens)
 // thr: threshold factor (0 to 1)
 void cursor_set_threshold(float thr)
 {
-	thresh = thr*JOY_MAX_DISP; // Convert to raw ADC values
+	joy_set_dead_zone(thr); // Radial, shared with the joystick stage
 }
 
 // Get the cursor position in screen coordinates.
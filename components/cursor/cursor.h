@@ -26,6 +26,13 @@ int32_t cursor_init(uint32_t per);
 // Therefore, it must be called from a software task context.
 void cursor_tick(void);
 
+// Move the cursor by a joystick displacement, as cursor_tick() does with
+// the displacement read from the joystick. Used when the joystick is
+// read elsewhere, e.g., by an input layer that records and replays it.
+// dx: displacement from -1.0 (left) to 1.0 (right).
+// dy: displacement from -1.0 (up) to 1.0 (down).
+void cursor_move(float dx, float dy);
+
 // Set the sensitivity (speed) of the cursor relative to joystick movement.
 // The sensitivity is specified as a factor in units of screen widths/sec
 // at full joystick displacement. The default is 1.25 screen widths per second.
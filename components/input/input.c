@@ -0,0 +1,194 @@
+#include <stddef.h> // NULL
+
+#include "joy.h"
+#include "buttons.h"
+#include "input.h"
+
+// Live frames are quantized to the log format too, so a session plays
+// the same whether it is live, recorded or replayed.
+
+#define Q15_ONE 32767
+#define CLIP(x,lo,hi) ((x) < (lo) ? (lo) : ((x) > (hi) ? (hi) : (x)))
+
+static input_mode_t mode;
+static input_frame_t cur; // Current frame
+
+// Button pins in frame bit order
+static int8_t btn_pin[INPUT_BTN_MAX];
+static uint32_t btn_num;
+
+// Log
+static input_frame_t log_buf[INPUT_LOG_LEN];
+static uint32_t log_len; // Frames recorded
+static uint32_t log_seed;
+static const input_frame_t *play; // Log being replayed
+static uint32_t play_len, play_idx;
+
+
+// Convert a factor (-1.0 to 1.0) to Q15.
+static int16_t to_q15(float f)
+{
+	int32_t q = (int32_t)(f*Q15_ONE + ((f < 0.0f) ? -0.5f : 0.5f));
+	return CLIP(q, -Q15_ONE, Q15_ONE);
+}
+
+// Convert a pin mask to frame button bits.
+static uint8_t to_bits(uint64_t pins)
+{
+	uint8_t bits = 0;
+
+	for (uint32_t i = 0; i < btn_num; i++)
+		if ((pins >> btn_pin[i]) & 1) bits |= 1U << i;
+	return bits;
+}
+
+// Convert frame button bits to a pin mask.
+static uint64_t to_pins(uint8_t bits)
+{
+	uint64_t pins = 0;
+
+	for (uint32_t i = 0; i < btn_num; i++)
+		if ((bits >> i) & 1) pins |= 1LLU << btn_pin[i];
+	return pins;
+}
+
+// Take a frame from the joystick and buttons.
+static void input_sample(input_frame_t *f)
+{
+	float x, y;
+
+	joy_get_shaped(&x, &y);
+	f->x = to_q15(x);
+	f->y = to_q15(y);
+	f->press = to_bits(buttons_pressed());
+	f->down = to_bits(buttons_state());
+}
+
+// Initialize the input layer and the joystick and button drivers. The
+// mode is INPUT_LIVE.
+// mask: bit mask of the button pins, e.g., HW_BTN_MASK (up to
+// INPUT_BTN_MAX buttons).
+// Return zero if successful, or non-zero otherwise.
+int32_t input_init(uint64_t mask)
+{
+	btn_num = 0;
+	for (int8_t p = 0; p < 64; p++) {
+		if (!((mask >> p) & 1)) continue;
+		if (btn_num >= INPUT_BTN_MAX) return -1;
+		btn_pin[btn_num++] = p;
+	}
+	mode = INPUT_LIVE;
+	cur = (input_frame_t){0};
+	log_len = 0;
+	if (joy_init()) return -1;
+	return buttons_init(mask);
+}
+
+// Take the input frame for the next tick. Call once at the start of
+// each game tick. When a replay reaches the end of its log the mode
+// returns to INPUT_LIVE.
+// Return true if a frame was taken, or false if the replay finished.
+bool input_tick(void)
+{
+	switch (mode) {
+	case INPUT_REPLAY:
+		if (play_idx < play_len) {
+			cur = play[play_idx++];
+			return true;
+		}
+		mode = INPUT_LIVE;
+		cur = (input_frame_t){0};
+		buttons_pressed(); // Drop presses made during the replay
+		return false;
+	case INPUT_RECORD:
+		input_sample(&cur);
+		log_buf[log_len++] = cur;
+		if (log_len >= INPUT_LOG_LEN) mode = INPUT_LIVE;
+		return true;
+	case INPUT_LIVE:
+	default:
+		input_sample(&cur);
+		return true;
+	}
+}
+
+// Get the joystick displacement of the current frame, after the dead
+// zone and response curve (see joy_get_shaped()).
+// *x: set from -1.0 (left) to 1.0 (right).
+// *y: set from -1.0 (up) to 1.0 (down).
+void input_get_joy(float *x, float *y)
+{
+	*x = (float)cur.x / Q15_ONE;
+	*y = (float)cur.y / Q15_ONE;
+}
+
+// Return a bit mask of the pins pressed during the current frame, like
+// pin_get_in_reg() but one-shot and active high.
+uint64_t input_pressed(void)
+{
+	return to_pins(cur.press);
+}
+
+// Return a bit mask of the pins held down in the current frame.
+uint64_t input_down(void)
+{
+	return to_pins(cur.down);
+}
+
+// Start recording frames to the log, from the next call to input_tick().
+// Recording stops when the log is full.
+// seed: value used to seed random numbers in the recorded session,
+// returned by input_seed() for the replay.
+// Return zero if successful, or non-zero otherwise.
+int32_t input_record(uint32_t seed)
+{
+	log_len = 0;
+	log_seed = seed;
+	mode = INPUT_RECORD;
+	return 0;
+}
+
+// Start replaying frames, from the next call to input_tick().
+// frames: log to replay, or NULL for the recorded log.
+// len: number of frames in the log (ignored if frames is NULL).
+// Return zero if successful, or non-zero otherwise.
+int32_t input_replay(const input_frame_t *frames, uint32_t len)
+{
+	if (frames == NULL) {
+		frames = log_buf;
+		len = log_len;
+	}
+	if (len == 0) return -1;
+	play = frames;
+	play_len = len;
+	play_idx = 0;
+	mode = INPUT_REPLAY;
+	return 0;
+}
+
+// Stop recording or replaying. The mode returns to INPUT_LIVE.
+void input_stop(void)
+{
+	mode = INPUT_LIVE;
+}
+
+// Return the current mode.
+input_mode_t input_mode(void)
+{
+	return mode;
+}
+
+// Get the recorded log.
+// **frames: set to the first frame of the log.
+// Return the number of frames in the log.
+uint32_t input_log(const input_frame_t **frames)
+{
+	*frames = log_buf;
+	return log_len;
+}
+
+// Return the seed given to input_record().
+uint32_t input_seed(void)
+{
+	return log_seed;
+}
@@ -0,0 +1,82 @@
+#ifndef INPUT_H_
+#define INPUT_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// The input layer takes one snapshot of the joystick and buttons per
+// game tick, so the game sees the same input for the whole tick. The
+// snapshots can be recorded to a log in RAM and replayed later, which
+// reproduces a game session exactly when the game is fed only through
+// this layer and its random numbers are seeded from the log.
+
+#define INPUT_LOG_LEN 4096 // Frames in the log, 6 bytes each
+#define INPUT_BTN_MAX 8 // Buttons in a frame
+
+// One tick of input.
+typedef struct {
+	int16_t x, y;  // Shaped joystick displacement, Q15 (-1.0 to 1.0)
+	uint8_t press; // Buttons pressed during the tick, a bit per button
+	uint8_t down;  // Buttons held down at the tick, a bit per button
+} input_frame_t;
+
+typedef enum {
+	INPUT_LIVE,   // Frames come from the joystick and buttons
+	INPUT_RECORD, // Live, and frames are added to the log
+	INPUT_REPLAY, // Frames come from a log
+} input_mode_t;
+
+// Initialize the input layer and the joystick and button drivers. The
+// mode is INPUT_LIVE.
+// mask: bit mask of the button pins, e.g., HW_BTN_MASK (up to
+// INPUT_BTN_MAX buttons).
+// Return zero if successful, or non-zero otherwise.
+int32_t input_init(uint64_t mask);
+
+// Take the input frame for the next tick. Call once at the start of
+// each game tick. When a replay reaches the end of its log the mode
+// returns to INPUT_LIVE.
+// Return true if a frame was taken, or false if the replay finished.
+bool input_tick(void);
+
+// Get the joystick displacement of the current frame, after the dead
+// zone and response curve (see joy_get_shaped()).
+// *x: set from -1.0 (left) to 1.0 (right).
+// *y: set from -1.0 (up) to 1.0 (down).
+void input_get_joy(float *x, float *y);
+
+// Return a bit mask of the pins pressed during the current frame, like
+// pin_get_in_reg() but one-shot and active high.
+uint64_t input_pressed(void);
+
+// Return a bit mask of the pins held down in the current frame.
+uint64_t input_down(void);
+
+// Start recording frames to the log, from the next call to input_tick().
+// Recording stops when the log is full.
+// seed: value used to seed random numbers in the recorded session,
+// returned by input_seed() for the replay.
+// Return zero if successful, or non-zero otherwise.
+int32_t input_record(uint32_t seed);
+
+// Start replaying frames, from the next call to input_tick().
+// frames: log to replay, or NULL for the recorded log.
+// len: number of frames in the log (ignored if frames is NULL).
+// Return zero if successful, or non-zero otherwise.
+int32_t input_replay(const input_frame_t *frames, uint32_t len);
+
+// Stop recording or replaying. The mode returns to INPUT_LIVE.
+void input_stop(void);
+
+// Return the current mode.
+input_mode_t input_mode(void);
+
+// Get the recorded log.
+// **frames: set to the first frame of the log.
+// Return the number of frames in the log.
+uint32_t input_log(const input_frame_t **frames);
+
+// Return the seed given to input_record().
+uint32_t input_seed(void);
+
+#endif // INPUT_H_
@@ -1,64 +1,277 @@
 #include "joy.h"
-#include "esp_adc/adc_oneshot.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_attr.h"
+#include "esp_adc/adc_continuous.h"
+#include "nvs.h"
 
-#define SAMPLE_SIZE 5
+#define CHAN_X ADC_CHANNEL_6
+#define CHAN_Y ADC_CHANNEL_7
+#define FRAME_HZ 250 // DMA frames (callbacks) per second
+#define POOL_FRAMES 4 // Frames the ADC driver may hold
+#define FILT_SHIFT 2 // Each frame moves the filter 1/4 of the way
+#define FRAC_BITS 4 // Fraction bits of the filter state
+#define CAL_FRAMES 16 // Frames averaged to find the center
+#define CAL_POLL_MS 10
+#define CAL_TIMEOUT_MS 500
+#define HALF_BITS 16
+#define SCALE_BITS 12 // Fraction bits of the range scale factors
+#define NVS_NS "joy" // NVS namespace
+#define NVS_KEY "cal" // NVS key of the saved calibration
+#define CAL_VERSION 1
+#define CAL_SPAN_MIN (JOY_MAX_DISP/4) // Smallest accepted extent
 
-adc_oneshot_unit_handle_t adc1_handle;
+static adc_continuous_handle_t adc_handle;
 int_fast32_t calX;
 int_fast32_t calY;
 
+// Calibration saved in NVS
+typedef struct {
+    uint16_t version;
+    int16_t cx, cy; // Center
+    int16_t xmin, xmax, ymin, ymax; // Extents
+} joy_cal_t;
+
+// Scale factors from displacement to +/- JOY_MAX_DISP for each side of
+// each axis, with SCALE_BITS fraction bits
+static int32_t scaleXn = 1 << SCALE_BITS, scaleXp = 1 << SCALE_BITS;
+static int32_t scaleYn = 1 << SCALE_BITS, scaleYp = 1 << SCALE_BITS;
+
+// Updated by the conversion done callback
+static int32_t filtX, filtY; // Filtered readings with FRAC_BITS
+static uint32_t calSumX, calSumY;
+static volatile uint32_t calN; // Frames summed for calibration
+// Latest filtered reading, x in the low half and y in the high half, so
+// that one 32-bit load gets a matching pair without a lock.
+static volatile uint32_t latest;
+
+// ADC conversion done callback (ISR). Average each channel over the DMA
+// frame, filter, and publish the result.
+static bool IRAM_ATTR joy_conv_done(adc_continuous_handle_t handle,
+    const adc_continuous_evt_data_t *edata, void *user_data) {
+
+    uint32_t sumX = 0, sumY = 0, nX = 0, nY = 0;
+    for (uint32_t i = 0; i < edata->size; i += SOC_ADC_DIGI_RESULT_BYTES) {
+        const adc_digi_output_data_t *p = (const void *)(edata->conv_frame_buffer + i);
+        if (p->type1.channel == CHAN_X) {
+            sumX += p->type1.data;
+            nX++;
+        } else if (p->type1.channel == CHAN_Y) {
+            sumY += p->type1.data;
+            nY++;
+        }
+    }
+    if (nX == 0 || nY == 0) return false;
+    int32_t avgX = sumX / nX, avgY = sumY / nY;
+
+    if (calN == 0) { // start the filter at the first reading
+        filtX = avgX << FRAC_BITS;
+        filtY = avgY << FRAC_BITS;
+    } else {
+        filtX += ((avgX << FRAC_BITS) - filtX) >> FILT_SHIFT;
+        filtY += ((avgY << FRAC_BITS) - filtY) >> FILT_SHIFT;
+    }
+    if (calN < CAL_FRAMES) {
+        calSumX += avgX;
+        calSumY += avgY;
+    }
+    if (calN <= CAL_FRAMES) calN++;
+    latest = (uint32_t)(filtX >> FRAC_BITS) | (uint32_t)(filtY >> FRAC_BITS) << HALF_BITS;
+    return false; // no high priority task awoken
+}
+
+static int32_t wait_frames(uint32_t n);
+static bool cal_load(joy_cal_t *cal);
+static void cal_apply(const joy_cal_t *cal);
+
 // Initialize the joystick driver. Must be called before use.
 // May be called multiple times. Return if already initialized.
 // Return zero if successful, or non-zero otherwise.
 int32_t joy_init(void) {
+    return joy_init_rate(JOY_RATE_DEFAULT);
+}
+
+// Initialize the joystick driver, converting at the given rate.
+// May be called multiple times. Return if already initialized.
+// hz: ADC conversions per second, shared by the x and y channels
+// (JOY_RATE_MIN to JOY_RATE_MAX).
+// Return zero if successful, or non-zero otherwise.
+int32_t joy_init_rate(uint32_t hz) {
+    if (adc_handle) return 0;
+    if (hz < JOY_RATE_MIN || hz > JOY_RATE_MAX) return -1;
+
+    // one callback every DMA frame, an even number of conversions
+    uint32_t n = (hz / FRAME_HZ) & ~1U;
+    if (n < 2) n = 2;
+    uint32_t frame = n * SOC_ADC_DIGI_RESULT_BYTES;
 
-    // set up ADC handler with configuration
-    adc_oneshot_unit_init_cfg_t init_config1 = {
-        .unit_id = ADC_UNIT_1,
-        .ulp_mode = ADC_ULP_MODE_DISABLE,
+    // set up ADC continuous (DMA) handle with configuration
+    adc_continuous_handle_cfg_t handle_config = {
+        .max_store_buf_size = frame * POOL_FRAMES,
+        .conv_frame_size = frame,
+        .flags.flush_pool = 1, // drop old frames, the callback has them
     };
-    ESP_ERROR_CHECK(adc_oneshot_new_unit(&init_config1, &adc1_handle));
+    ESP_ERROR_CHECK(adc_continuous_new_handle(&handle_config, &adc_handle));
 
-    // connect channels 6 and 7 to the ADC unit
-    adc_oneshot_chan_cfg_t config = {
-        .bitwidth = ADC_BITWIDTH_DEFAULT,
-        .atten = ADC_ATTEN_DB_12,
+    // convert channels 6 and 7 alternately
+    adc_digi_pattern_config_t pattern[2];
+    adc_channel_t chan[2] = {CHAN_X, CHAN_Y};
+    for (int i = 0; i < 2; i++) {
+        pattern[i].atten = ADC_ATTEN_DB_12;
+        pattern[i].channel = chan[i];
+        pattern[i].unit = ADC_UNIT_1;
+        pattern[i].bit_width = SOC_ADC_DIGI_MAX_BITWIDTH;
+    }
+    adc_continuous_config_t dig_config = {
+        .pattern_num = 2,
+        .adc_pattern = pattern,
+        .sample_freq_hz = hz,
+        .conv_mode = ADC_CONV_SINGLE_UNIT_1,
+        .format = ADC_DIGI_OUTPUT_FORMAT_TYPE1,
     };
-    ESP_ERROR_CHECK(adc_oneshot_config_channel(adc1_handle, ADC_CHANNEL_6, &config));
-    ESP_ERROR_CHECK(adc_oneshot_config_channel(adc1_handle, ADC_CHANNEL_7, &config));
+    ESP_ERROR_CHECK(adc_continuous_config(adc_handle, &dig_config));
 
-    int_fast32_t rx;
-    for (int i = 0; i < SAMPLE_SIZE; i++) {
-        ESP_ERROR_CHECK(adc_oneshot_read(adc1_handle, ADC_CHANNEL_6, &rx));
-        calX += rx;
+    adc_continuous_evt_cbs_t cbs = {
+        .on_conv_done = joy_conv_done,
+    };
+    ESP_ERROR_CHECK(adc_continuous_register_event_callbacks(adc_handle, &cbs, NULL));
+    calN = calSumX = calSumY = 0;
+    ESP_ERROR_CHECK(adc_continuous_start(adc_handle));
 
-        ESP_ERROR_CHECK(adc_oneshot_read(adc1_handle, ADC_CHANNEL_7, &rx));
-        calY += rx;
+    // use the saved calibration, otherwise average the center position
+    joy_cal_t cal;
+    bool saved = cal_load(&cal);
+    if (saved) cal_apply(&cal);
+    if (wait_frames(saved ? 1 : CAL_FRAMES)) {
+        joy_deinit();
+        return -1;
+    }
+    if (!saved) {
+        calX = calSumX / CAL_FRAMES;
+        calY = calSumY / CAL_FRAMES;
     }
-    
-    calX /= SAMPLE_SIZE;
-    calY /= SAMPLE_SIZE;
 
     return 0;
 }
 
+// Wait until the callback has seen n frames since calN was cleared.
+// Return zero if successful, or non-zero on timeout.
+static int32_t wait_frames(uint32_t n) {
+    for (int t = 0; calN < n; t += CAL_POLL_MS) {
+        if (t >= CAL_TIMEOUT_MS) return -1;
+        vTaskDelay(pdMS_TO_TICKS(CAL_POLL_MS));
+    }
+    return 0;
+}
+
+// Open the joystick NVS namespace. NVS is initialized by the
+// application, so an error is returned if it is not.
+static esp_err_t cal_open(nvs_open_mode_t mode, nvs_handle_t *h) {
+    return nvs_open(NVS_NS, mode, h);
+}
+
+// Load the saved calibration.
+// Return true if a valid calibration was found, otherwise false.
+static bool cal_load(joy_cal_t *cal) {
+    nvs_handle_t h;
+    size_t len = sizeof(*cal);
+    if (cal_open(NVS_READONLY, &h) != ESP_OK) return false;
+    esp_err_t err = nvs_get_blob(h, NVS_KEY, cal, &len);
+    nvs_close(h);
+    return err == ESP_OK && len == sizeof(*cal) && cal->version == CAL_VERSION;
+}
+
+// Return the scale factor that maps a span of raw values to JOY_MAX_DISP.
+static int32_t cal_scale(int32_t span) {
+    if (span < CAL_SPAN_MIN) span = CAL_SPAN_MIN;
+    return (JOY_MAX_DISP << SCALE_BITS) / span;
+}
+
+// Use a calibration for the center position and range.
+static void cal_apply(const joy_cal_t *cal) {
+    calX = cal->cx;
+    calY = cal->cy;
+    scaleXn = cal_scale(cal->cx - cal->xmin);
+    scaleXp = cal_scale(cal->xmax - cal->cx);
+    scaleYn = cal_scale(cal->cy - cal->ymin);
+    scaleYp = cal_scale(cal->ymax - cal->cy);
+}
+
+// Calibrate the joystick and save the result in NVS so that later calls
+// to joy_init() start without sampling the center. The joystick must be
+// centered when called, and then moved around its full range (e.g., in
+// circles at full displacement) until the function returns.
+// ms: time in milliseconds to capture the range.
+// Return zero if successful, or non-zero otherwise (e.g., the range was
+// too small on some side or NVS is not initialized).
+int32_t joy_calibrate(uint32_t ms) {
+    joy_cal_t cal = {.version = CAL_VERSION};
+    nvs_handle_t h;
+    if (!adc_handle) return -1;
+
+    // center
+    calN = calSumX = calSumY = 0;
+    if (wait_frames(CAL_FRAMES)) return -1;
+    cal.cx = calSumX / CAL_FRAMES;
+    cal.cy = calSumY / CAL_FRAMES;
+
+    // extents
+    cal.xmin = cal.xmax = cal.cx;
+    cal.ymin = cal.ymax = cal.cy;
+    for (uint32_t t = 0; t < ms; t += CAL_POLL_MS) {
+        vTaskDelay(pdMS_TO_TICKS(CAL_POLL_MS));
+        uint32_t xy = latest;
+        int16_t x = xy & 0xFFFF, y = xy >> HALF_BITS;
+        if (x < cal.xmin) cal.xmin = x;
+        if (x > cal.xmax) cal.xmax = x;
+        if (y < cal.ymin) cal.ymin = y;
+        if (y > cal.ymax) cal.ymax = y;
+    }
+    if (cal.cx - cal.xmin < CAL_SPAN_MIN || cal.xmax - cal.cx < CAL_SPAN_MIN ||
+        cal.cy - cal.ymin < CAL_SPAN_MIN || cal.ymax - cal.cy < CAL_SPAN_MIN)
+        return -1;
+    cal_apply(&cal);
+
+    if (cal_open(NVS_READWRITE, &h) != ESP_OK) return -1;
+    esp_err_t err = nvs_set_blob(h, NVS_KEY, &cal, sizeof(cal));
+    if (err == ESP_OK) err = nvs_commit(h);
+    nvs_close(h);
+    return (err == ESP_OK) ? 0 : -1;
+}
+
+// Erase the saved calibration. The next joy_init() samples the center.
+// Return zero if successful, or non-zero otherwise.
+int32_t joy_cal_erase(void) {
+    nvs_handle_t h;
+    if (cal_open(NVS_READWRITE, &h) != ESP_OK) return -1;
+    esp_err_t err = nvs_erase_key(h, NVS_KEY);
+    if (err == ESP_OK) err = nvs_commit(h);
+    nvs_close(h);
+    return (err == ESP_OK || err == ESP_ERR_NVS_NOT_FOUND) ? 0 : -1;
+}
+
 // Free resources used by the joystick (ADC unit).
 // Return zero if successful, or non-zero otherwise.
 int32_t joy_deinit(void) {
-    if (adc1_handle) ESP_ERROR_CHECK(adc_oneshot_del_unit(adc1_handle));
+    if (adc_handle) {
+        ESP_ERROR_CHECK(adc_continuous_stop(adc_handle));
+        ESP_ERROR_CHECK(adc_continuous_deinit(adc_handle));
+        adc_handle = NULL;
+    }
     return 0;
 }
 
 // Get the joystick displacement from center position.
 // Displacement values range from 0 to +/- JOY_MAX_DISP.
-// This function is not safe to call from an ISR context.
-// Therefore, it must be called from a software task context.
 // *dcx: pointer to displacement in x.
 // *dcy: pointer to displacement in y.
 void joy_get_displacement(int32_t *dcx, int32_t *dcy) {
-    int_fast32_t rx;
-    ESP_ERROR_CHECK(adc_oneshot_read(adc1_handle, ADC_CHANNEL_6, &rx));
-    *dcx = rx - calX;
-    ESP_ERROR_CHECK(adc_oneshot_read(adc1_handle, ADC_CHANNEL_7, &rx));
-    *dcy = rx - calY;
-}
\ No newline at end of file
+    uint32_t xy = latest;
+    int32_t dx = (int32_t)(xy & 0xFFFF) - calX;
+    int32_t dy = (int32_t)(xy >> HALF_BITS) - calY;
+    // normalize each side to the calibrated range
+    dx = (dx * ((dx < 0) ? scaleXn : scaleXp)) >> SCALE_BITS;
+    dy = (dy * ((dy < 0) ? scaleYn : scaleYp)) >> SCALE_BITS;
+    *dcx = (dx < -JOY_MAX_DISP) ? -JOY_MAX_DISP : (dx > JOY_MAX_DISP) ? JOY_MAX_DISP : dx;
+    *dcy = (dy < -JOY_MAX_DISP) ? -JOY_MAX_DISP : (dy > JOY_MAX_DISP) ? JOY_MAX_DISP : dy;
+}
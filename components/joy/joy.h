@@ -1,6 +1,7 @@
 #ifndef JOY_H_
 #define JOY_H_
 
+#include <stdbool.h>
 #include <stdint.h>
 
 // Maximum joystick displacement in raw ADC values
@@ -8,21 +9,91 @@
 // by this maximum, will give a proportion between 0 and +/- 1.
 #define JOY_MAX_DISP 2048
 
+// The x and y channels are converted continuously by the ADC into DMA
+// buffers. Each buffer is averaged and filtered in the conversion done
+// callback, so reading the joystick takes constant time and does not
+// wait for the ADC. On the ESP32 the ADC DMA shares I2S0 with the DAC
+// DMA, so this driver cannot be used with the sound_cont driver.
+
+#define JOY_RATE_MIN 20000 // Minimum ADC conversions per second
+#define JOY_RATE_MAX 200000 // Maximum ADC conversions per second
+#define JOY_RATE_DEFAULT JOY_RATE_MIN
+
 // Initialize the joystick driver. Must be called before use.
 // May be called multiple times. Return if already initialized.
+// A calibration saved by joy_calibrate() is used if present, otherwise
+// the center is averaged from the joystick at rest. The calibration is
+// kept in NVS, which the application must initialize first (see
+// nvs_flash_init()); without NVS the center is always averaged.
 // Return zero if successful, or non-zero otherwise.
 int32_t joy_init(void);
 
+// Initialize the joystick driver, converting at the given rate.
+// May be called multiple times. Return if already initialized.
+// hz: ADC conversions per second, shared by the x and y channels
+// (JOY_RATE_MIN to JOY_RATE_MAX).
+// Return zero if successful, or non-zero otherwise.
+int32_t joy_init_rate(uint32_t hz);
+
 // Free resources used by the joystick (ADC unit).
 // Return zero if successful, or non-zero otherwise.
 int32_t joy_deinit(void);
 
+// Calibrate the joystick and save the result in NVS so that later calls
+// to joy_init() start without sampling the center. The center and the
+// extent of each side of each axis are recorded, and displacement is
+// then scaled so the physical range maps to +/- JOY_MAX_DISP. The
+// joystick must be centered when called, and then moved around its full
+// range (e.g., in circles at full displacement) until the function returns.
+// Blocks for about ms, so call it from a task, not a timer callback.
+// lab04 calibrates when START is held down at power-up.
+// ms: time in milliseconds to capture the range.
+// Return zero if successful, or non-zero otherwise (e.g., the range was
+// too small on some side or NVS is not initialized).
+int32_t joy_calibrate(uint32_t ms);
+
+// Erase the saved calibration. The next joy_init() samples the center.
+// lab04 erases it when SELECT is held down at power-up.
+// Return zero if successful, or non-zero otherwise.
+int32_t joy_cal_erase(void);
+
 // Get the joystick displacement from center position.
 // Displacement values range from 0 to +/- JOY_MAX_DISP.
-// This function is not safe to call from an ISR context.
-// Therefore, it must be called from a software task context.
+// The latest filtered reading is returned without waiting or locking,
+// so this function may be called from any context.
 // *dcx: pointer to displacement in x.
 // *dcy: pointer to displacement in y.
 void joy_get_displacement(int32_t *dcx, int32_t *dcy);
 
+// Processing stage (joy_proc.c) used by the cursor and navigator.
+
+// Response curves applied to the displacement outside the dead zone.
+// Quadratic and exponential curves give finer control near center.
+typedef enum {JOY_CURVE_LINEAR, JOY_CURVE_QUAD, JOY_CURVE_EXP} joy_curve_t;
+
+// Get the processed joystick displacement. A median filter removes
+// spikes and a low-pass filter removes jitter. Inside the radial dead
+// zone the output is zero and, if enabled, the center slowly follows the
+// reading to cancel drift. Outside, the distance past the dead zone is
+// rescaled to 0-1 and shaped by the response curve, keeping the
+// direction. Call once per update period from a task.
+// *x: pointer to x displacement, -1 to +1.
+// *y: pointer to y displacement, -1 to +1.
+void joy_get_shaped(float *x, float *y);
+
+// Set the radial dead zone as a factor (0 to 1) of maximum displacement.
+// The default is 0.075.
+// thr: dead zone radius factor.
+void joy_set_dead_zone(float thr);
+
+// Set the response curve applied outside the dead zone.
+// The default is JOY_CURVE_LINEAR.
+// c: curve type.
+void joy_set_curve(joy_curve_t c);
+
+// Enable or disable tracking of center drift inside the dead zone.
+// The default is enabled.
+// enable: if true, track drift, otherwise hold the calibrated center.
+void joy_set_recenter(bool enable);
+
 #endif // JOY_H_
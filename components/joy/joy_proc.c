@@ -0,0 +1,109 @@
+// Joystick processing stage shared by the cursor and navigator. Readings
+// from joy_get_displacement() are filtered, recentered, passed through a
+// radial dead zone, and shaped by a response curve.
+
+#include <math.h> // sqrtf, expf, fabsf
+
+#include "joy.h"
+
+#define DEAD_ZONE_DEFAULT 0.075f // Factor of maximum displacement
+#define CURVE_DEFAULT JOY_CURVE_LINEAR
+#define LPF_ALPHA 0.5f // Weight of a new reading in the low-pass filter
+#define EXP_K 3.0f // Steepness of the exponential curve
+#define RECENTER_ALPHA 0.02f // Weight of a reading when tracking drift
+#define MED_N 3 // Median filter length
+
+static float dead = DEAD_ZONE_DEFAULT;
+static joy_curve_t curve = CURVE_DEFAULT;
+static bool recenter = true;
+static float exp_norm; // 1/(e^k-1), computed on first use
+
+static int32_t histX[MED_N], histY[MED_N]; // Last readings
+static uint32_t hidx; // Next reading in the history
+static bool primed; // History and filter hold readings
+static float lpfX, lpfY; // Low-pass filter state
+static float offX, offY; // Drift of the center position
+
+
+// Return the median of three values.
+static inline int32_t median3(int32_t a, int32_t b, int32_t c) {
+    if (a > b) {int32_t t = a; a = b; b = t;}
+    if (b > c) b = c;
+    return (a > b) ? a : b;
+}
+
+// Return the response curve applied to a magnitude from 0 to 1.
+static float shape(float r) {
+    switch (curve) {
+        case JOY_CURVE_QUAD:
+            return r*r;
+        case JOY_CURVE_EXP:
+            if (exp_norm == 0.0f) exp_norm = 1.0f/(expf(EXP_K)-1.0f);
+            return (expf(EXP_K*r)-1.0f)*exp_norm;
+        default:
+            return r;
+    }
+}
+
+// Get the processed joystick displacement. A median filter removes
+// spikes and a low-pass filter removes jitter. Inside the radial dead
+// zone the output is zero and, if enabled, the center slowly follows the
+// reading to cancel drift. Outside, the distance past the dead zone is
+// rescaled to 0-1 and shaped by the response curve, keeping the
+// direction. Call once per update period from a task.
+// *x: pointer to x displacement, -1 to +1.
+// *y: pointer to y displacement, -1 to +1.
+void joy_get_shaped(float *x, float *y) {
+    int32_t dcx, dcy;
+    joy_get_displacement(&dcx, &dcy);
+    if (!primed) {
+        for (uint32_t i = 0; i < MED_N; i++) {
+            histX[i] = dcx;
+            histY[i] = dcy;
+        }
+        lpfX = dcx;
+        lpfY = dcy;
+        primed = true;
+    }
+    histX[hidx] = dcx;
+    histY[hidx] = dcy;
+    hidx = (hidx+1) % MED_N;
+    lpfX += (median3(histX[0], histX[1], histX[2]) - lpfX)*LPF_ALPHA;
+    lpfY += (median3(histY[0], histY[1], histY[2]) - lpfY)*LPF_ALPHA;
+
+    float fx = (lpfX - offX)/JOY_MAX_DISP;
+    float fy = (lpfY - offY)/JOY_MAX_DISP;
+    float r = sqrtf(fx*fx + fy*fy);
+    if (r <= dead) {
+        if (recenter) {
+            offX += (lpfX - offX)*RECENTER_ALPHA;
+            offY += (lpfY - offY)*RECENTER_ALPHA;
+        }
+        *x = *y = 0.0f;
+        return;
+    }
+    float m = (r-dead)/(1.0f-dead);
+    if (m > 1.0f) m = 1.0f;
+    m = shape(m)/r;
+    *x = fx*m;
+    *y = fy*m;
+}
+
+// Set the radial dead zone as a factor (0 to 1) of maximum displacement.
+// thr: dead zone radius factor.
+void joy_set_dead_zone(float thr) {
+    dead = (thr < 0.0f) ? 0.0f : (thr > 0.95f) ? 0.95f : thr;
+}
+
+// Set the response curve applied outside the dead zone.
+// c: curve type.
+void joy_set_curve(joy_curve_t c) {
+    curve = c;
+}
+
+// Enable or disable tracking of center drift inside the dead zone.
+// enable: if true, track drift, otherwise hold the calibrated center.
+void joy_set_recenter(bool enable) {
+    recenter = enable;
+    if (!enable) offX = offY = 0.0f;
+}
@@ -1376,3 +1376,26 @@ void lcd_writeFrame(void)
 #endif
 	return;
 }
+
+void lcd_writeRect(coord_t x, coord_t y, coord_t w, coord_t h)
+{
+	if (dev->use_frame_buffer == false) return;
+	if (x < 0) {w += x; x = 0;} // clip to screen
+	if (y < 0) {h += y; y = 0;}
+	if (x+w > dev->width) w = dev->width-x;
+	if (y+h > dev->height) h = dev->height-y;
+	if (w <= 0 || h <= 0) return;
+
+	spi_master_write_command(dev, 0x2A); // Column(x) Address Set
+	spi_master_write_addr(dev, dev->offsetx+x, dev->offsetx+x+w-1);
+	spi_master_write_command(dev, 0x2B); // Page(y) Address Set
+	spi_master_write_addr(dev, dev->offsety+y, dev->offsety+y+h-1);
+	spi_master_write_command(dev, 0x2C); // Memory Write
+	color_t *row = dev->frame_buffer + y*dev->width + x;
+	if (w == dev->width) { // rows are contiguous
+		spi_master_write_colors(dev, row, (size_t)w*h);
+	} else {
+		for (coord_t j = 0; j < h; j++, row += dev->width)
+			spi_master_write_colors(dev, row, w);
+	}
+}
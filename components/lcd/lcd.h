@@ -478,6 +478,16 @@ void lcd_wrapAround(scroll_t scroll, coord_t start, coord_t end);
  */
 void lcd_writeFrame(void);
 
+/**
+ * @brief Write a rectangle of the frame buffer to display, e.g., only the
+ *  part of the frame that changed. Requires frame buffer to be enabled.
+ * @param x Top left corner X coordinate.
+ * @param y Top left corner Y coordinate.
+ * @param w Width in pixels.
+ * @param h Height in pixels.
+ */
+void lcd_writeRect(coord_t x, coord_t y, coord_t w, coord_t h);
+
 /** @} */
 
 #endif // LCD_H_
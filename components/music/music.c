@@ -0,0 +1,257 @@
+#include <stddef.h> // NULL
+#include <stdatomic.h>
+#include <math.h> // sinf, powf
+
+#include "esp_attr.h"
+
+#include "sound.h"
+#include "music.h"
+
+// The song is sequenced and synthesized by music_gen(), which is called
+// from the audio refill path (ISR context). Only integer math is used
+// there. Tables that need floating point are built by music_init().
+// The application hands a song to the refill path through 'pending'.
+// The refill path may run on the other core, so it takes the song with
+// an atomic exchange: a song handed over while it looks is never lost.
+
+#define WAVE_BITS 8
+#define WAVE_LEN (1U << WAVE_BITS) // Samples in one wavetable cycle
+#define PHASE_SHIFT (32 - WAVE_BITS)
+#define PHASE_ONE 4294967296.0f // One cycle of the phase accumulator
+#define AMPLITUDE 127
+#define CENTER 0x80
+#define NOTES 128 // MIDI note numbers
+#define A4_NOTE 69
+#define A4_FREQ 440.0f
+#define SEMITONES 12.0f
+
+#define ENV_MAX (1 << 24) // Full envelope level
+#define ENV_SHIFT 16      // Envelope level to 8-bit gain
+#define MIX_SHIFT 9       // Two voices at full level reach full scale
+#define MS_PER_S 1000U
+#define SEC_PER_MIN 60U
+
+#define CLIP(x,lo,hi) ((x) < (lo) ? (lo) : ((x) > (hi) ? (hi) : (x)))
+
+// Envelope stages
+typedef enum {ENV_OFF, ENV_ATK, ENV_DEC, ENV_SUS, ENV_REL} env_t;
+
+typedef struct {
+	const int8_t *wave; // Wavetable
+	uint32_t phase;     // Phase accumulator, top bits index the wavetable
+	uint32_t step;      // Phase increment per sample
+	int32_t level;      // Envelope level, 0 to ENV_MAX
+	int32_t att, dec, sus, rel; // Envelope rates per sample and sustain level
+	uint32_t gate;      // Samples until release
+	env_t stage;
+} voice_t;
+
+// Tables built at init
+static uint32_t rate; // Sample rate in Hz
+static uint32_t note_step[NOTES];
+static int8_t wave[LAST_T][WAVE_LEN];
+
+// Hand-off from application to refill path
+static _Atomic(const music_song_t *) pending;
+static volatile bool stop_req;
+static volatile bool playing;
+
+// Refill path state
+static const music_song_t *song;
+static uint32_t ev;   // Next event
+static uint32_t wait; // Samples until next event
+static uint32_t spt;  // Samples per tick
+static bool seq_on;   // Sequencer running
+static voice_t voice[MUSIC_VOICES];
+static uint32_t vnext; // Next voice to allocate
+
+// Convert milliseconds to samples, at least one.
+static inline uint32_t IRAM_ATTR ms2s(uint32_t ms)
+{
+	uint32_t s = ms*rate/MS_PER_S;
+	return s ? s : 1;
+}
+
+// Release all voices.
+static void IRAM_ATTR music_release(void)
+{
+	for (uint32_t i = 0; i < MUSIC_VOICES; i++)
+		if (voice[i].stage != ENV_OFF) voice[i].stage = ENV_REL;
+}
+
+// Start a note on a free voice, or steal the next one.
+static void IRAM_ATTR music_note(const music_event_t *e)
+{
+	if (e->note == MUSIC_REST || e->note >= NOTES || e->inst >= song->ninst) return;
+	uint32_t i, n;
+	for (i = 0, n = vnext; i < MUSIC_VOICES; i++, n = (n+1) % MUSIC_VOICES)
+		if (voice[n].stage == ENV_OFF) break;
+	vnext = (n+1) % MUSIC_VOICES;
+
+	const music_inst_t *in = song->insts + e->inst;
+	voice_t *v = voice + n;
+	v->wave = wave[(in->wave < LAST_T) ? in->wave : SINE_T];
+	v->step = note_step[e->note];
+	v->sus = (int32_t)in->sustain << ENV_SHIFT;
+	v->att = ENV_MAX / ms2s(in->attack);
+	v->dec = (ENV_MAX - v->sus) / ms2s(in->decay);
+	if (v->dec == 0) v->dec = 1;
+	v->rel = ENV_MAX / ms2s(in->release);
+	v->gate = e->dur ? e->dur*spt : 1;
+	v->stage = ENV_ATK; // level continues from a stolen voice
+}
+
+// Start the events that are due.
+static void IRAM_ATTR music_seq(void)
+{
+	while (seq_on && wait == 0) {
+		if (ev < song->len) {
+			const music_event_t *e = song->events + ev++;
+			music_note(e);
+			if (ev < song->len) wait = song->events[ev].delta*spt;
+			else wait = (e->dur ? e->dur : 1)*spt; // end after last note
+		} else if (song->loop) {
+			ev = 0;
+			wait = song->events[0].delta*spt;
+		} else {
+			seq_on = false;
+		}
+	}
+}
+
+// Advance the envelope and oscillator of a voice by one sample.
+static inline int32_t IRAM_ATTR music_voice(voice_t *v)
+{
+	switch (v->stage) {
+	case ENV_OFF:
+		return 0;
+	case ENV_ATK:
+		v->level += v->att;
+		if (v->level >= ENV_MAX) {
+			v->level = ENV_MAX;
+			v->stage = ENV_DEC;
+		}
+		break;
+	case ENV_DEC:
+		v->level -= v->dec;
+		if (v->level <= v->sus) {
+			v->level = v->sus;
+			v->stage = ENV_SUS;
+		}
+		break;
+	case ENV_SUS:
+		break;
+	case ENV_REL:
+		v->level -= v->rel;
+		if (v->level <= 0) {
+			v->level = 0;
+			v->stage = ENV_OFF;
+			return 0;
+		}
+		break;
+	}
+	if (v->stage != ENV_REL && --v->gate == 0) v->stage = ENV_REL;
+	v->phase += v->step;
+	return v->wave[v->phase >> PHASE_SHIFT] * (v->level >> ENV_SHIFT);
+}
+
+// Sound generator (refill path).
+static uint32_t IRAM_ATTR music_gen(uint8_t *buf, uint32_t size, void *arg)
+{
+	const music_song_t *s = atomic_exchange_explicit(&pending, NULL, memory_order_acq_rel);
+	if (s != NULL) {
+		playing = true; // May have been cleared as s was handed over
+		music_release();
+		song = s;
+		ev = 0;
+		spt = rate*SEC_PER_MIN / (s->bpm*MUSIC_TPB);
+		if (spt == 0) spt = 1;
+		wait = s->events[0].delta*spt;
+		seq_on = true;
+	}
+	if (stop_req) {
+		stop_req = false;
+		seq_on = false;
+		music_release();
+	}
+
+	bool on = seq_on;
+	for (uint32_t i = 0; i < MUSIC_VOICES; i++)
+		on = on || voice[i].stage != ENV_OFF;
+	if (!on) {
+		if (atomic_load_explicit(&pending, memory_order_acquire) == NULL) playing = false;
+		return 0; // finished
+	}
+
+	for (uint32_t i = 0; i < size; i++) {
+		if (seq_on) {
+			music_seq();
+			if (wait) wait--;
+		}
+		int32_t out = 0;
+		for (uint32_t v = 0; v < MUSIC_VOICES; v++)
+			out += music_voice(voice+v);
+		out >>= MIX_SHIFT;
+		buf[i] = CLIP(out, -AMPLITUDE, AMPLITUDE) + CENTER;
+	}
+	return size;
+}
+
+// Initialize the music player. Must be called before using music and
+// after the sound (or tone) component is initialized.
+// sample_hz: sample rate in Hz passed to sound_init().
+// Return zero if successful, or non-zero otherwise.
+int32_t music_init(uint32_t sample_hz)
+{
+	if (sample_hz == 0) return -1;
+	sound_generate(NULL, NULL);
+	atomic_store_explicit(&pending, NULL, memory_order_relaxed);
+	playing = false;
+	rate = sample_hz;
+
+	// Phase increment for each note
+	for (uint32_t n = 0; n < NOTES; n++) {
+		float freq = A4_FREQ * powf(2.0f, (n - (float)A4_NOTE) / SEMITONES);
+		// Notes above the Nyquist frequency are silent
+		note_step[n] = (freq < sample_hz/2) ? (uint32_t)(freq / sample_hz * PHASE_ONE) : 0;
+	}
+
+	// One cycle of each waveform, centered on zero
+	for (uint32_t i = 0; i < WAVE_LEN; i++) {
+		wave[SINE_T][i] = AMPLITUDE * sinf(2*M_PI*i/WAVE_LEN);
+		wave[SQUARE_T][i] = (i < WAVE_LEN/2) ? AMPLITUDE : -AMPLITUDE;
+		wave[TRIANGLE_T][i] = (i < WAVE_LEN/4) ? (int32_t)(4*AMPLITUDE*i/WAVE_LEN) :
+			(i < 3*WAVE_LEN/4) ? (int32_t)(2*AMPLITUDE - 4*AMPLITUDE*i/WAVE_LEN) :
+			(int32_t)(4*AMPLITUDE*i/WAVE_LEN - 4*AMPLITUDE);
+		wave[SAW_T][i] = (int32_t)(2*AMPLITUDE*i/WAVE_LEN) - AMPLITUDE;
+	}
+	return 0;
+}
+
+// Start playing a song in the background. A song already playing is
+// replaced. The song and its tables must remain valid while playing.
+// song: pointer to the song.
+// Return zero if successful, or non-zero otherwise.
+int32_t music_play(const music_song_t *s)
+{
+	if (rate == 0 || s == NULL || s->events == NULL || s->len == 0 ||
+		s->insts == NULL || s->bpm == 0) return -1;
+	stop_req = false;
+	playing = true;
+	atomic_store_explicit(&pending, s, memory_order_release);
+	sound_generate(music_gen, NULL);
+	return 0;
+}
+
+// Stop playing. Notes sounding are released according to their envelope.
+void music_stop(void)
+{
+	atomic_store_explicit(&pending, NULL, memory_order_release);
+	stop_req = true;
+}
+
+// Return true if music is playing, otherwise return false.
+bool music_busy(void)
+{
+	return playing && sound_generating();
+}
@@ -0,0 +1,66 @@
+#ifndef MUSIC_H_
+#define MUSIC_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "tone.h" // tone_t
+
+// This component plays music in the background through the sound
+// component's generator interface. A song is a compact list of note
+// events that is sequenced from the audio refill path with sample
+// accuracy, so no application timer is needed per note. Each note is
+// played on a voice with an attack/decay/sustain/release (ADSR) envelope
+// defined by its instrument. Music is mixed with sound effects started
+// with sound_start().
+
+#define MUSIC_VOICES 4 // Maximum simultaneous notes
+#define MUSIC_TPB 4    // Sequencer ticks per beat (16th notes)
+#define MUSIC_REST 0   // Note number of a rest (no sound)
+
+// Instrument: a waveform shaped by an ADSR envelope.
+typedef struct {
+	tone_t wave;      // Waveform
+	uint16_t attack;  // Time to rise to full level in ms
+	uint16_t decay;   // Time to fall to sustain level in ms
+	uint8_t sustain;  // Sustain level, 0-255 of full level
+	uint16_t release; // Time to fall from full level to zero in ms
+} music_inst_t;
+
+// Note event. Times are in sequencer ticks (MUSIC_TPB per beat).
+typedef struct {
+	uint8_t delta; // Ticks after the start of the previous event
+	uint8_t note;  // MIDI note number (60 is middle C, 69 is A4)
+	uint8_t dur;   // Ticks until note is released
+	uint8_t inst;  // Index into the song's instrument table
+} music_event_t;
+
+// Song: note events, instruments, and tempo.
+typedef struct {
+	const music_event_t *events;
+	uint32_t len;              // Number of events
+	const music_inst_t *insts;
+	uint32_t ninst;            // Number of instruments
+	uint16_t bpm;              // Tempo in beats per minute
+	bool loop;                 // Repeat from the start when done
+} music_song_t;
+
+// Initialize the music player. Must be called before using music and
+// after the sound (or tone) component is initialized.
+// sample_hz: sample rate in Hz passed to sound_init().
+// Return zero if successful, or non-zero otherwise.
+int32_t music_init(uint32_t sample_hz);
+
+// Start playing a song in the background. A song already playing is
+// replaced. The song and its tables must remain valid while playing.
+// song: pointer to the song.
+// Return zero if successful, or non-zero otherwise.
+int32_t music_play(const music_song_t *song);
+
+// Stop playing. Notes sounding are released according to their envelope.
+void music_stop(void);
+
+// Return true if music is playing, otherwise return false.
+bool music_busy(void);
+
+#endif // MUSIC_H_
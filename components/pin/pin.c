@@ -41,6 +41,12 @@
 #define REG_CLR_BIT(r,b) (REG(r) &= ~(1U << (b)))
 #define REG_GET_BIT(r,b) ((REG(r) >> (b)) & 1U)
 
+// Split a 64-bit pin mask into the masks of the two 32-bit registers
+#define MASK_LO(m) ((uint32_t)(m))
+#define MASK_HI(m) ((uint32_t)((m) >> REG_BITS))
+
+#define PIN_COUNT 40
+
 // Gives byte offset of IO_MUX Configuration Register
 // from base address DR_REG_IO_MUX_BASE
 static const uint8_t PIN_MUX_REG_OFFSET[] = {
@@ -129,6 +135,53 @@ int32_t pin_odrain(pin_num_t pin, bool enable)
 	return 0;
 }
 
+// Reset and configure all pins in the mask, one pin per bit. This has
+// the same result as pin_reset() followed by each single pin function,
+// enabled if its flag is given and disabled if not, but each register is
+// written once, and the output enable and level of all pins are set with
+// one write per register. Unlike pin_reset() alone, a pin has no
+// pull-up unless PIN_PULLUP is given.
+// mask: bit mask of the pins, e.g., HW_BTN_MASK.
+// flags: PIN_INPUT, PIN_OUTPUT, PIN_PULLUP, PIN_PULLDOWN and PIN_ODRAIN.
+int32_t pin_config_mask(uint64_t mask, uint32_t flags)
+{
+	// IO_MUX_x_REG: MCU_SEL=2 (GPIO), FUN_DRV=2, pulls and input enable
+	uint32_t mux = (1U << (MCU_SEL + 1)) | (1U << (FUN_DRV + 1));
+	if (flags & PIN_PULLUP) mux |= 1U << FUN_WPU;
+	if (flags & PIN_PULLDOWN) mux |= 1U << FUN_WPD;
+	if (flags & PIN_INPUT) mux |= 1U << FUN_IE;
+	uint32_t pad = (flags & PIN_ODRAIN) ? 1U << PAD_DRIVER : 0;
+
+	if (mask >> PIN_COUNT) return -1;
+	for (pin_num_t pin = 0; pin < PIN_COUNT; pin++) {
+		if (!((mask >> pin) & 1)) continue;
+		if (PIN_MUX_REG_OFFSET[pin] == 0xFF) return -1;
+		uint32_t pin_mux = mux;
+		if (rtc_gpio_is_valid_gpio(pin)) { // hand-off work to RTC subsystem
+			rtc_gpio_deinit(pin);
+			(flags & PIN_PULLUP) ? rtc_gpio_pullup_en(pin) : rtc_gpio_pullup_dis(pin);
+			(flags & PIN_PULLDOWN) ? rtc_gpio_pulldown_en(pin) : rtc_gpio_pulldown_dis(pin);
+			// Pulls are set by the RTC subsystem, FUN_WPU is left as
+			// pin_reset() sets it
+			pin_mux = (mux | 1U << FUN_WPU) & ~(1U << FUN_WPD);
+		}
+		REG(GPIO_PIN0_REG + (REG_BYTES * pin)) = pad;
+		REG(GPIO_FUNCn_OUT_SEL_CFG_REG + (REG_BYTES * pin)) = 0x100;
+		REG(IO_MUX_REG(pin)) = pin_mux;
+	}
+
+	// Output level zero, then enable or disable all outputs at once
+	pin_clear_mask(mask);
+	if (flags & PIN_OUTPUT) {
+		if (MASK_LO(mask)) REG(GPIO_ENABLE_W1TS_REG) = MASK_LO(mask);
+		if (MASK_HI(mask)) REG(GPIO_ENABLE1_W1TS_REG) = MASK_HI(mask);
+	} else {
+		if (MASK_LO(mask)) REG(GPIO_ENABLE_W1TC_REG) = MASK_LO(mask);
+		if (MASK_HI(mask)) REG(GPIO_ENABLE1_W1TC_REG) = MASK_HI(mask);
+	}
+	return 0;
+}
+
 // Sets the output signal level if the pin is configured as an output.
 int32_t pin_set_level(pin_num_t pin, int32_t level)
 {
@@ -152,6 +205,26 @@ int32_t pin_get_level(pin_num_t pin)
 	}
 }
 
+// Set the output signal level to one on all pins in the mask, leaving
+// the other pins unchanged.
+int32_t pin_set_mask(uint64_t mask)
+{
+	// Write the mask to the W1TS registers, no read-modify-write needed
+	if (MASK_LO(mask)) REG(GPIO_OUT_W1TS_REG) = MASK_LO(mask);
+	if (MASK_HI(mask)) REG(GPIO_OUT1_W1TS_REG) = MASK_HI(mask);
+	return 0;
+}
+
+// Set the output signal level to zero on all pins in the mask, leaving
+// the other pins unchanged.
+int32_t pin_clear_mask(uint64_t mask)
+{
+	// Write the mask to the W1TC registers, no read-modify-write needed
+	if (MASK_LO(mask)) REG(GPIO_OUT_W1TC_REG) = MASK_LO(mask);
+	if (MASK_HI(mask)) REG(GPIO_OUT1_W1TC_REG) = MASK_HI(mask);
+	return 0;
+}
+
 // Get the value of the input registers, one pin per bit.
 // The two 32-bit input registers are concatenated into a uint64_t.
 uint64_t pin_get_in_reg(void)
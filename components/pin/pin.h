@@ -6,9 +6,17 @@
 
 typedef int8_t pin_num_t;
 
+// Flags for pin_config_mask(), may be combined with |
+#define PIN_INPUT    (1U << 0) // Input signal enabled
+#define PIN_OUTPUT   (1U << 1) // Output signal enabled
+#define PIN_PULLUP   (1U << 2) // Pull-up enabled
+#define PIN_PULLDOWN (1U << 3) // Pull-down enabled
+#define PIN_ODRAIN   (1U << 4) // Open-drain output
+
 // Each of the functions below with a pin argument operate on a single pin.
-// The exceptions are pin_get_in_reg() and pin_get_out_reg which return
-// the state of all the I/O pins.
+// The exceptions are the *_mask() functions, which operate on all pins
+// with a bit set in the mask, and pin_get_in_reg() and pin_get_out_reg()
+// which return the state of all the I/O pins.
 
 /***** I/O pin configuration *****/
 
@@ -31,6 +39,16 @@ int32_t pin_output(pin_num_t pin, bool enable);
 // Enable or disable the pin as an open-drain signal.
 int32_t pin_odrain(pin_num_t pin, bool enable);
 
+// Reset and configure all pins in the mask, one pin per bit. This has
+// the same result as pin_reset() followed by each single pin function,
+// enabled if its flag is given and disabled if not, but each register is
+// written once, and the output enable and level of all pins are set with
+// one write per register. Unlike pin_reset() alone, a pin has no
+// pull-up unless PIN_PULLUP is given.
+// mask: bit mask of the pins, e.g., HW_BTN_MASK.
+// flags: PIN_INPUT, PIN_OUTPUT, PIN_PULLUP, PIN_PULLDOWN and PIN_ODRAIN.
+int32_t pin_config_mask(uint64_t mask, uint32_t flags);
+
 /***** Set and get individual I/O pin signal levels *****/
 
 // Sets the output signal level if the pin is configured as an output.
@@ -39,6 +57,14 @@ int32_t pin_set_level(pin_num_t pin, int32_t level);
 // Gets the input signal level if the pin is configured as an input.
 int32_t pin_get_level(pin_num_t pin);
 
+// Set the output signal level to one on all pins in the mask, leaving
+// the other pins unchanged.
+int32_t pin_set_mask(uint64_t mask);
+
+// Set the output signal level to zero on all pins in the mask, leaving
+// the other pins unchanged.
+int32_t pin_clear_mask(uint64_t mask);
+
 /***** Get I/O register values, one pin per bit *****/
 
 // Get the value of the input registers, one pin per bit.
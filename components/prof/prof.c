@@ -0,0 +1,144 @@
+#include <stdio.h>
+
+#include "esp_timer.h"
+
+#include "prof.h"
+
+#define SUB_SHIFT 3 // log2 of the bins per power of two
+#define SUB (1U << SUB_SHIFT)
+#define MSB(x) (31 - __builtin_clz(x))
+
+typedef struct {
+	uint32_t bin[PROF_BINS];
+	uint32_t max;
+	uint64_t sum;
+} hist_t;
+
+static const char *phase_name[PROF_PHASES+1] = {
+	[PROF_INPUT] = "input",
+	[PROF_SIMULATE] = "simulate",
+	[PROF_RENDER] = "render",
+	[PROF_FLUSH] = "flush",
+	[PROF_PHASES] = "frame",
+};
+
+static hist_t hist[PROF_PHASES+1]; // Last one is the whole frame
+static uint32_t frames, missed;
+static uint32_t deadline;
+static int64_t t_begin, t_last;
+static uint32_t acc[PROF_PHASES]; // Phase times of the current frame
+
+
+// Return the bin of a time in us.
+static uint32_t to_bin(uint32_t us)
+{
+	if (us < SUB) return us;
+	uint32_t shift = MSB(us) - SUB_SHIFT;
+	return (shift+1)*SUB + (us >> shift) - SUB;
+}
+
+// Return the largest time in us that falls in a bin.
+static uint32_t bin_top(uint32_t b)
+{
+	if (b < 2*SUB) return b;
+	uint32_t shift = b/SUB - 1;
+	return (((b%SUB + SUB) + 1) << shift) - 1;
+}
+
+static void hist_add(hist_t *h, uint32_t us)
+{
+	h->bin[to_bin(us)]++;
+	h->sum += us;
+	if (us > h->max) h->max = us;
+}
+
+// Initialize the profiler and clear the statistics.
+// deadline_us: time allowed for a frame, e.g., the game timer period.
+void prof_init(uint32_t deadline_us)
+{
+	deadline = deadline_us;
+	prof_reset();
+}
+
+// Clear the statistics.
+void prof_reset(void)
+{
+	for (uint32_t p = 0; p <= PROF_PHASES; p++)
+		hist[p] = (hist_t){0};
+	frames = missed = 0;
+}
+
+// Start timing a frame. The first phase starts now.
+void prof_frame_begin(void)
+{
+	t_begin = t_last = esp_timer_get_time();
+	for (uint32_t p = 0; p < PROF_PHASES; p++) acc[p] = 0;
+}
+
+// End the current phase and start the next. The time since the last
+// mark (or frame begin) is added to the phase, so a phase may be marked
+// more than once in a frame, e.g., when several ticks are simulated.
+// phase: the phase that just ended.
+void prof_mark(prof_phase_t phase)
+{
+	int64_t now = esp_timer_get_time();
+
+	if (phase < PROF_PHASES) acc[phase] += now - t_last;
+	t_last = now;
+}
+
+// End the frame and add the phase and frame times to the histograms.
+void prof_frame_end(void)
+{
+	uint32_t total = esp_timer_get_time() - t_begin;
+
+	for (uint32_t p = 0; p < PROF_PHASES; p++) hist_add(hist+p, acc[p]);
+	hist_add(hist+PROF_PHASES, total);
+	frames++;
+	if (total > deadline) missed++;
+}
+
+// Return a percentile of the time of a phase in us.
+// phase: the phase, or PROF_PHASES for the whole frame.
+// pct: percentile from 0 to 100.
+uint32_t prof_percentile(prof_phase_t phase, uint32_t pct)
+{
+	const hist_t *h = hist+phase;
+	uint64_t rank = ((uint64_t)frames*pct + 99) / 100; // Round up
+	uint64_t n = 0;
+
+	if (phase > PROF_PHASES || frames == 0) return 0;
+	if (rank == 0) rank = 1;
+	for (uint32_t b = 0; b < PROF_BINS; b++) {
+		n += h->bin[b];
+		if (n >= rank) {
+			uint32_t top = bin_top(b);
+			return (top < h->max) ? top : h->max;
+		}
+	}
+	return h->max;
+}
+
+// Return the number of frames that were longer than the deadline.
+uint32_t prof_missed(void)
+{
+	return missed;
+}
+
+// Print a table of the mean, p50, p95, p99 and max time of each phase
+// and of the frame, and the number of missed deadlines.
+void prof_print(void)
+{
+	printf("%-9s %8s %8s %8s %8s %8s (us)\n", "phase", "mean", "p50", "p95", "p99", "max");
+	for (uint32_t p = 0; p <= PROF_PHASES; p++) {
+		const hist_t *h = hist+p;
+		printf("%-9s %8lu %8lu %8lu %8lu %8lu\n", phase_name[p],
+			(unsigned long)(frames ? h->sum/frames : 0),
+			(unsigned long)prof_percentile(p, 50),
+			(unsigned long)prof_percentile(p, 95),
+			(unsigned long)prof_percentile(p, 99),
+			(unsigned long)h->max);
+	}
+	printf("Missed %lu of %lu frames (deadline %lu us)\n",
+		(unsigned long)missed, (unsigned long)frames, (unsigned long)deadline);
+}
@@ -0,0 +1,53 @@
+#ifndef PROF_H_
+#define PROF_H_
+
+#include <stdint.h>
+
+// The frame profiler times the phases of each frame of a game loop and
+// keeps a histogram of the durations of each phase and of the whole
+// frame, from which percentiles are reported. Bins are 1 us wide up to
+// 8 us, then 8 bins per power of two, so a percentile is within 12.5%.
+// A frame longer than the deadline is counted as missed.
+
+#define PROF_BINS 240 // Histogram bins, enough for any uint32_t us
+
+typedef enum {
+	PROF_INPUT,    // Reading input
+	PROF_SIMULATE, // Game logic
+	PROF_RENDER,   // Drawing to the frame buffer
+	PROF_FLUSH,    // Writing the frame to the display
+	PROF_PHASES,
+} prof_phase_t;
+
+// Initialize the profiler and clear the statistics.
+// deadline_us: time allowed for a frame, e.g., the game timer period.
+void prof_init(uint32_t deadline_us);
+
+// Clear the statistics.
+void prof_reset(void);
+
+// Start timing a frame. The first phase starts now.
+void prof_frame_begin(void);
+
+// End the current phase and start the next. The time since the last
+// mark (or frame begin) is added to the phase, so a phase may be marked
+// more than once in a frame, e.g., when several ticks are simulated.
+// phase: the phase that just ended.
+void prof_mark(prof_phase_t phase);
+
+// End the frame and add the phase and frame times to the histograms.
+void prof_frame_end(void);
+
+// Return a percentile of the time of a phase in us.
+// phase: the phase, or PROF_PHASES for the whole frame.
+// pct: percentile from 0 to 100.
+uint32_t prof_percentile(prof_phase_t phase, uint32_t pct);
+
+// Return the number of frames that were longer than the deadline.
+uint32_t prof_missed(void);
+
+// Print a table of the mean, p50, p95, p99 and max time of each phase
+// and of the frame, and the number of missed deadlines.
+void prof_print(void);
+
+#endif // PROF_H_
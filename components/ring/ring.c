@@ -0,0 +1,120 @@
+#include <string.h> // memcpy
+
+#include "esp_attr.h"
+
+#include "ring.h"
+
+#define LOAD(x, mo) atomic_load_explicit(&(x), memory_order_##mo)
+#define STORE(x, v, mo) atomic_store_explicit(&(x), (v), memory_order_##mo)
+
+// Functions are in IRAM since either side may be an ISR.
+
+// Initialize a ring. Not safe while the ring is in use.
+// *r: ring to initialize.
+// buf: storage for the ring data.
+// size: size of buf in bytes, a power of two.
+// Return zero if successful, or non-zero otherwise.
+int32_t ring_init(ring_t *r, uint8_t *buf, uint32_t size)
+{
+	if (buf == NULL || size == 0 || (size & (size-1))) return 1;
+	r->buf = buf;
+	r->mask = size-1;
+	ring_reset(r);
+	return 0;
+}
+
+// Discard the ring data. Not safe while the ring is in use.
+// *r: ring to reset.
+void ring_reset(ring_t *r)
+{
+	STORE(r->head, 0, relaxed);
+	STORE(r->tail, 0, relaxed);
+}
+
+// Return the number of bytes that can be read.
+uint32_t IRAM_ATTR ring_count(ring_t *r)
+{
+	return LOAD(r->head, acquire) - LOAD(r->tail, acquire);
+}
+
+// Return the number of bytes that can be written.
+uint32_t IRAM_ATTR ring_space(ring_t *r)
+{
+	return r->mask+1 - ring_count(r);
+}
+
+// Copy data into the ring (producer).
+// data: bytes to write.
+// len: number of bytes to write.
+// Return the number of bytes written, less than len if the ring is full.
+uint32_t IRAM_ATTR ring_write(ring_t *r, const uint8_t *data, uint32_t len)
+{
+	uint32_t h = LOAD(r->head, relaxed); // only this side writes head
+	uint32_t space = r->mask+1 - (h - LOAD(r->tail, acquire));
+	if (len > space) len = space;
+	uint32_t i = h & r->mask;
+	uint32_t n = r->mask+1 - i; // contiguous to the end of buf
+	if (n > len) n = len;
+	memcpy(r->buf+i, data, n);
+	memcpy(r->buf, data+n, len-n);
+	STORE(r->head, h+len, release);
+	return len;
+}
+
+// Copy data out of the ring (consumer).
+// data: buffer that receives the bytes.
+// len: number of bytes to read.
+// Return the number of bytes read, less than len if the ring is empty.
+uint32_t IRAM_ATTR ring_read(ring_t *r, uint8_t *data, uint32_t len)
+{
+	uint32_t t = LOAD(r->tail, relaxed); // only this side writes tail
+	uint32_t count = LOAD(r->head, acquire) - t;
+	if (len > count) len = count;
+	uint32_t i = t & r->mask;
+	uint32_t n = r->mask+1 - i;
+	if (n > len) n = len;
+	memcpy(data, r->buf+i, n);
+	memcpy(data+n, r->buf, len-n);
+	STORE(r->tail, t+len, release);
+	return len;
+}
+
+// Get the contiguous free space at the head to write in place (producer).
+// Follow with ring_write_commit() when the data has been written.
+// **p: set to the first free byte.
+// Return the number of contiguous bytes that may be written.
+uint32_t IRAM_ATTR ring_write_ptr(ring_t *r, uint8_t **p)
+{
+	uint32_t h = LOAD(r->head, relaxed);
+	uint32_t space = r->mask+1 - (h - LOAD(r->tail, acquire));
+	uint32_t i = h & r->mask;
+	uint32_t n = r->mask+1 - i;
+	*p = r->buf+i;
+	return (n < space) ? n : space;
+}
+
+// Publish n bytes written in place at the head (producer).
+void IRAM_ATTR ring_write_commit(ring_t *r, uint32_t n)
+{
+	STORE(r->head, LOAD(r->head, relaxed)+n, release);
+}
+
+// Get the contiguous data at the tail to read in place (consumer).
+// Follow with ring_read_commit() when the data has been used.
+// **p: set to the first byte of data.
+// Return the number of contiguous bytes that may be read.
+uint32_t IRAM_ATTR ring_read_ptr(ring_t *r, const uint8_t **p)
+{
+	uint32_t t = LOAD(r->tail, relaxed);
+	uint32_t count = LOAD(r->head, acquire) - t;
+	uint32_t i = t & r->mask;
+	uint32_t n = r->mask+1 - i;
+	*p = r->buf+i;
+	return (n < count) ? n : count;
+}
+
+// Release n bytes read in place at the tail (consumer).
+void IRAM_ATTR ring_read_commit(ring_t *r, uint32_t n)
+{
+	STORE(r->tail, LOAD(r->tail, relaxed)+n, release);
+}
@@ -0,0 +1,73 @@
+#ifndef RING_H_
+#define RING_H_
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+// Single producer, single consumer ring buffer of bytes. One task or ISR
+// writes and one task or ISR reads, concurrently and without locks. The
+// producer only writes head and the consumer only writes tail. Each side
+// publishes with a release store and observes the other side with an
+// acquire load, so the data is visible before the index that covers it.
+// The size is a power of two so the free running indices wrap with a
+// mask. The producer and consumer indices are kept on separate cache
+// lines so the two sides do not contend for one line.
+
+#define RING_ALIGN 32 // Separates the producer and consumer indices
+
+typedef struct {
+	uint8_t *buf;
+	uint32_t mask; // size-1
+	_Alignas(RING_ALIGN) atomic_uint_least32_t head; // Written by producer
+	_Alignas(RING_ALIGN) atomic_uint_least32_t tail; // Written by consumer
+} ring_t;
+
+// Initialize a ring. Not safe while the ring is in use.
+// *r: ring to initialize.
+// buf: storage for the ring data.
+// size: size of buf in bytes, a power of two.
+// Return zero if successful, or non-zero otherwise.
+int32_t ring_init(ring_t *r, uint8_t *buf, uint32_t size);
+
+// Discard the ring data. Not safe while the ring is in use.
+// *r: ring to reset.
+void ring_reset(ring_t *r);
+
+// Return the number of bytes that can be read.
+uint32_t ring_count(ring_t *r);
+
+// Return the number of bytes that can be written.
+uint32_t ring_space(ring_t *r);
+
+// Copy data into the ring (producer).
+// data: bytes to write.
+// len: number of bytes to write.
+// Return the number of bytes written, less than len if the ring is full.
+uint32_t ring_write(ring_t *r, const uint8_t *data, uint32_t len);
+
+// Copy data out of the ring (consumer).
+// data: buffer that receives the bytes.
+// len: number of bytes to read.
+// Return the number of bytes read, less than len if the ring is empty.
+uint32_t ring_read(ring_t *r, uint8_t *data, uint32_t len);
+
+// Get the contiguous free space at the head to write in place (producer).
+// Follow with ring_write_commit() when the data has been written.
+// **p: set to the first free byte.
+// Return the number of contiguous bytes that may be written.
+uint32_t ring_write_ptr(ring_t *r, uint8_t **p);
+
+// Publish n bytes written in place at the head (producer).
+void ring_write_commit(ring_t *r, uint32_t n);
+
+// Get the contiguous data at the tail to read in place (consumer).
+// Follow with ring_read_commit() when the data has been used.
+// **p: set to the first byte of data.
+// Return the number of contiguous bytes that may be read.
+uint32_t ring_read_ptr(ring_t *r, const uint8_t **p);
+
+// Release n bytes read in place at the tail (consumer).
+void ring_read_commit(ring_t *r, uint32_t n);
+
+#endif // RING_H_
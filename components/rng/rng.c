@@ -0,0 +1,50 @@
+#include "rng.h"
+
+// Constants of the PCG32 reference implementation
+#define RNG_MUL 6364136223846793005ULL
+#define RNG_INC 1442695040888963407ULL
+
+
+// Seed a generator. The same seed gives the same sequence.
+// *r: generator to seed.
+// seed: any value.
+void rng_seed(rng_t *r, uint64_t seed)
+{
+	r->state = 0;
+	rng_next(r);
+	r->state += seed;
+	rng_next(r);
+}
+
+// Return the next random 32-bit value.
+// *r: generator.
+uint32_t rng_next(rng_t *r)
+{
+	uint64_t s = r->state;
+	uint32_t x = (uint32_t)(((s >> 18) ^ s) >> 27);
+	uint32_t rot = (uint32_t)(s >> 59);
+
+	r->state = s*RNG_MUL + RNG_INC;
+	return (x >> rot) | (x << ((-rot) & 31));
+}
+
+// Return a random value in [0, n), each value equally likely (no modulo
+// bias). The value is the high word of a 32x32 bit product, and the
+// products that would make some values more likely are drawn again
+// (Lemire's method), so a division is only needed in the rare case.
+// *r: generator.
+// n: number of values, greater than zero.
+uint32_t rng_below(rng_t *r, uint32_t n)
+{
+	uint64_t m = (uint64_t)rng_next(r) * n;
+	uint32_t lo = (uint32_t)m;
+
+	if (lo < n) {
+		uint32_t t = -n % n; // 2^32 mod n
+		while (lo < t) {
+			m = (uint64_t)rng_next(r) * n;
+			lo = (uint32_t)m;
+		}
+	}
+	return (uint32_t)(m >> 32);
+}
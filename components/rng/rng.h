@@ -0,0 +1,30 @@
+#ifndef RNG_H_
+#define RNG_H_
+
+#include <stdint.h>
+
+// Small random number generator (PCG32: a 64-bit linear congruential
+// state with a permuted 32-bit output). Unlike rand(), each generator
+// has its own state and the sequence for a seed is the same on every
+// platform, so a game can be repeated exactly from its seed and input.
+
+typedef struct {
+	uint64_t state;
+} rng_t;
+
+// Seed a generator. The same seed gives the same sequence.
+// *r: generator to seed.
+// seed: any value.
+void rng_seed(rng_t *r, uint64_t seed);
+
+// Return the next random 32-bit value.
+// *r: generator.
+uint32_t rng_next(rng_t *r);
+
+// Return a random value in [0, n), each value equally likely (no modulo
+// bias).
+// *r: generator.
+// n: number of values, greater than zero.
+uint32_t rng_below(rng_t *r, uint32_t n);
+
+#endif // RNG_H_
@@ -4,10 +4,55 @@
 #include <stdbool.h>
 #include <stdint.h>
 
+#include "ring.h"
+
 #define MAX_VOL 100U
+#define SOUND_QUEUE_LEN 8 // Audio buffers that can wait in the queue
+#define SOUND_TASK_LEAD 512 // Samples the sound task mixes ahead
+#define SOUND_TAP_LEN 512 // Samples kept by the visualization tap
+#define SOUND_FFT_LEN 128 // Samples analyzed by sound_tap_bands()
+
+// Limits of the output buffer configuration, see sound_config()
+#define SOUND_DESC_MIN 2
+#define SOUND_DESC_MAX 16
+#define SOUND_BUF_MIN 8
+#define SOUND_BUF_MAX 1024
+
+// Driver statistics, see sound_stats(). Counts are since the driver was
+// initialized or sound_stats_reset() was called.
+typedef struct {
+	uint32_t desc_num;       // Number of output buffers
+	uint32_t buf_size;       // Size of each output buffer in bytes
+	uint32_t buf_us;         // Playback time of one output buffer in us
+	uint32_t fills;          // Refill callbacks
+	uint32_t late;           // Refills later than 1.5 buffer times
+	uint32_t underruns;      // Refills too late to keep the output busy
+	uint32_t fill_max_us;    // Longest time spent in a refill
+	uint32_t latency_us;     // Last sound start to DAC output time
+	uint32_t latency_max_us; // Longest sound start to DAC output time
+} sound_stats_t;
+
+// Callback function called each time an audio buffer finishes playing.
+// It is called from ISR context (or the timer driver's refill task, or
+// the sound task, see sound_task()), so it must be placed in IRAM
+// (IRAM_ATTR) and may only use ISR safe functions, e.g.,
+// vTaskNotifyGiveFromISR().
+// audio: pointer to the audio buffer that finished.
+// arg: argument given to sound_set_callback().
+// Return true if a higher priority task was woken, otherwise false.
+typedef bool (*sound_cb_t)(const void *audio, void *arg);
+
+// Generator function used to synthesize audio on demand (e.g., music).
+// It is called from the audio refill path, possibly in ISR context, so
+// it must be placed in IRAM (IRAM_ATTR), must not block, and must not
+// use floating point. Fill buf with up to size unsigned samples centered at 0x80.
+// Return the number of samples written. Returning less than size
+// indicates the generator is finished.
+typedef uint32_t (*sound_gen_t)(uint8_t *buf, uint32_t size, void *arg);
 
 // Initialize the sound driver. Must be called before using sound.
-// May be called again to change sample rate.
+// May be called again to change sample rate. The volume is set to the
+// default by the first call only.
 // sample_hz: sample rate in Hz to playback audio.
 // Return zero if successful, or non-zero otherwise.
 int32_t sound_init(uint32_t sample_hz);
@@ -19,24 +64,144 @@ int32_t sound_deinit(void);
 // Start playing the sound immediately. Play the audio buffer once.
 // audio: a pointer to an array of unsigned audio data.
 // size: the size of the array in bytes.
-// wait: if true, block until done playing, otherwise return straight away.
+// wait: if true, block until done playing, stopped or replaced by another
+// sound, otherwise return straight away.
 void sound_start(const void *audio, uint32_t size, bool wait);
 
+// Start playing the sound immediately. Play the audio buffer once,
+// converting it from its sample rate to the output sample rate given to
+// sound_init(). Clips of different rates can play without sound_init().
+// audio: a pointer to an array of unsigned audio data.
+// size: the size of the array in bytes.
+// sample_hz: sample rate in Hz of the audio data, zero for output rate.
+// wait: if true, block until done playing, stopped or replaced by another
+// sound, otherwise return straight away.
+void sound_start_hz(const void *audio, uint32_t size, uint32_t sample_hz, bool wait);
+
+// Queue an audio buffer to play once after those already playing or
+// queued, without a gap. If nothing is playing, it starts immediately.
+// sound_start(), sound_cyclic() and sound_stop() clear the queue.
+// audio: a pointer to an array of unsigned audio data.
+// size: the size of the array in bytes.
+// Return zero if successful, or non-zero if the queue is full.
+int32_t sound_enqueue(const void *audio, uint32_t size);
+
+// Queue an audio buffer to play once after those already playing or
+// queued, converting it from its sample rate to the output sample rate.
+// audio: a pointer to an array of unsigned audio data.
+// size: the size of the array in bytes.
+// sample_hz: sample rate in Hz of the audio data, zero for output rate.
+// Return zero if successful, or non-zero if the queue is full.
+int32_t sound_enqueue_hz(const void *audio, uint32_t size, uint32_t sample_hz);
+
 // Cyclically play samples from audio buffer until sound_stop() is called.
 // audio: a pointer to an array of unsigned audio data.
 // size: the size of the array in bytes.
 void sound_cyclic(const void *audio, uint32_t size);
 
-// Return true if sound playing, otherwise return false.
+// Return true if sound playing, otherwise return false. With the sound
+// task running, it stays true until the end of the audio buffer has left
+// the task's ring.
 bool sound_busy(void);
 
 // Stop playing the sound.
 void sound_stop(void);
 
+// Set a function to call each time an audio buffer finishes playing.
+// It is not called for a buffer ended by sound_stop() or replaced. With
+// the sound task running, it is called when the end of the buffer is
+// mixed, up to SOUND_TASK_LEAD samples before it is output.
+// cb: callback function, or NULL for none.
+// arg: argument passed to each call of the callback.
+void sound_set_callback(sound_cb_t cb, void *arg);
+
+// Start a generator that plays in the background, mixed with any audio
+// buffer started with sound_start() or sound_cyclic(). The generator runs
+// until it finishes or sound_generate(NULL, NULL) is called. It is not
+// affected by sound_stop().
+// gen: generator function, or NULL to stop the current generator.
+// arg: argument passed to each call of the generator.
+void sound_generate(sound_gen_t gen, void *arg);
+
+// Return true if a generator is running, otherwise return false.
+bool sound_generating(void);
+
+// Mix samples from a ring buffer that a feeder task (or the application)
+// fills, e.g., audio decoded or streamed ahead of time. The refill path
+// drains the ring without locks. If the ring runs empty, silence plays
+// until more samples arrive. It is not affected by sound_stop().
+// ring: ring of unsigned samples at the output rate, or NULL to stop.
+void sound_stream(ring_t *ring);
+
+// Mix audio in a task pinned to a core instead of in the driver's ISR.
+// The task mixes ahead into a ring of SOUND_TASK_LEAD samples, so the ISR
+// only copies samples and interrupt latency for the display and UART is
+// not lengthened by mixing, envelopes, or resampling. This adds up to
+// SOUND_TASK_LEAD samples of latency. Callbacks and generators then run
+// in the task, and callbacks and sound_start() with wait return when a
+// buffer is mixed, up to SOUND_TASK_LEAD samples before it is output.
+// Call after sound_init(), before starting any sound.
+// core: core to run the task on (1 is the core not used by Wi-Fi).
+// priority: task priority, above the application's tasks.
+// Return zero if successful, or non-zero otherwise.
+int32_t sound_task(uint32_t core, uint32_t priority);
+
+// Set the decimation of the visualization tap. Every dec-th output
+// sample (after volume) is kept in a ring of the last SOUND_TAP_LEN
+// samples, e.g., for an oscilloscope or spectrum display.
+// dec: keep one of every dec samples, or zero to turn the tap off (default).
+void sound_tap_config(uint32_t dec);
+
+// Copy the most recent output samples kept by the tap, oldest first.
+// The refill path does not wait for the copy, so a few of the newest
+// samples may be from the next refill, which is not visible in a display.
+// buf: buffer that receives the samples.
+// n: number of samples to copy, at most SOUND_TAP_LEN.
+// Return the number of samples copied.
+uint32_t sound_tap(uint8_t *buf, uint32_t n);
+
+// Compute the spectrum of the most recent SOUND_FFT_LEN tap samples with
+// a fixed-point FFT and reduce it to bands spaced logarithmically from
+// the lowest to the highest frequency. Bin k is k*rate/(dec*SOUND_FFT_LEN)
+// Hz. Call from a task, not an ISR.
+// bands: array that receives the magnitude of the strongest bin in each
+// band (a full-scale sine reads about 8000).
+// n: number of bands (1 to SOUND_FFT_LEN/2).
+// Return zero if successful, or non-zero otherwise (e.g., tap is off).
+int32_t sound_tap_bands(uint16_t *bands, uint32_t n);
+
 // Set the volume.
 // volume: 0-100% as an integer value.
 void sound_set_volume(uint32_t vol);
 
+// Set the number and size of the output buffers: the DMA buffers of the
+// DAC continuous driver, or the blocks of the timer driver's sample ring.
+// Fewer and smaller buffers lower the latency, but refills must then be
+// more timely. If the driver is initialized, it is restarted with the
+// new settings.
+// desc_num: number of buffers (SOUND_DESC_MIN to SOUND_DESC_MAX).
+// buf_size: size of each buffer in bytes (SOUND_BUF_MIN to SOUND_BUF_MAX).
+// The timer driver requires a power of two and at most 256 samples total.
+// Return zero if successful, or non-zero otherwise.
+int32_t sound_config(uint32_t desc_num, uint32_t buf_size);
+
+// Get the driver statistics.
+// *stats: pointer to structure that receives the statistics.
+void sound_stats(sound_stats_t *stats);
+
+// Clear the driver statistics.
+void sound_stats_reset(void);
+
+// Find the lowest latency buffer configuration that has no late refill
+// callbacks while the application runs its normal load (e.g., display
+// updates from another task). Configurations are tried in order of
+// increasing latency, each for the given time. The driver must be
+// initialized. Sound output is interrupted while tuning.
+// ms: time in milliseconds to measure each configuration.
+// Return zero if a configuration was found, or non-zero otherwise
+// (the configuration in use before the call is then restored).
+int32_t sound_autotune(uint32_t ms);
+
 // Enable or disable the sound output device.
 // enable: if true, enable sound, otherwise disable.
 void sound_device(bool enable);
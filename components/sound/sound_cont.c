@@ -1,90 +1,98 @@
 // https://docs.espressif.com/projects/esp-idf/en/stable/esp32/api-reference/peripherals/dac.html
 
-#include <string.h> // memset
-
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "esp_log.h"
 #include "esp_check.h"
+#include "esp_timer.h"
 #include "driver/dac_continuous.h"
 #include "driver/gpio.h"
 
 #include "hw.h"
 #include "sound.h"
+#include "sound_mix.h"
 
 #define SOUND_A  HW_SND_A  // Audio output
 #define SOUND_EN HW_SND_EN // Sound enable, active high
 
-#define DAC_DESC_NUM 8 // Number of DAC descriptors
-#define DAC_BUF_SZ 128 // DAC buffer size in bytes
+#define DAC_DESC_NUM 8 // Default number of DAC descriptors
+#define DAC_BUF_SZ 128 // Default DAC buffer size in bytes
 // was able to play audio at 48kHz with buf size of  8 and 8 desc, async.
 // was able to play audio at 48kHz with buf size of 64 and 8 desc, sync w/ vol control.
 
-#define SOUND_VOLUME_DEFAULT 50
-#define SILENCE 0x80U
-#define POLL_DELAY 10
-#define PERCENT 100U
+#if CONFIG_DAC_DMA_AUTO_16BIT_ALIGN
+#define BUF_SAMPLES(sz) ((sz)/2) // Each sample is padded to 16 bits
+#else
+#define BUF_SAMPLES(sz) (sz)
+#endif
 
-static const char *TAG = "sound";
+#define US_PER_S 1000000ULL
 
-// Critical section protected variables
-static portMUX_TYPE spinlock = portMUX_INITIALIZER_UNLOCKED;
-static const uint8_t *abase;
-static volatile uint32_t asize;
-static volatile uint32_t aidx;
-static volatile bool     cyclic;
-static volatile uint32_t dcnt;
+static const char *TAG = "sound";
 
-// Other global variables
+// Global variables
 static dac_continuous_handle_t dac_handle;
 static volatile bool device_en;
-static volatile uint32_t volume;
-static volatile uint8_t bias; // to prevent popping at end when vol low.
+static uint32_t dcnt; // Silent buffers left to write after sound ends
+static uint32_t rate; // Sample rate in Hz
+static uint32_t desc_num = DAC_DESC_NUM;
+static uint32_t buf_size = DAC_BUF_SZ;
+static uint8_t dbuf[SOUND_BUF_MAX]; // Refill buffer, too large for ISR stack
+
+// Statistics updated by the callback
+static uint32_t buf_us; // Playback time of one DMA buffer
+static int64_t last_us; // Time of the previous callback, zero if none
+static volatile uint32_t fills, late, underruns, fill_max_us;
 
 
 static bool IRAM_ATTR dac_convert_callback(dac_continuous_handle_t handle,
 	const dac_event_data_t *event, void *user_data)
 {
-#if CONFIG_DAC_DMA_AUTO_16BIT_ALIGN
-	uint8_t buf[event->buf_size/2];
-#else
-	uint8_t buf[event->buf_size];
-#endif
+	int64_t now = esp_timer_get_time();
+	uint32_t n = BUF_SAMPLES(event->buf_size);
+	if (n > sizeof(dbuf)) n = sizeof(dbuf);
+
+	// A callback is due every buf_us. The DMA keeps playing the other
+	// descriptors while a callback is late, until all of them are used.
+	if (last_us) {
+		uint32_t dt = now - last_us;
+		if (dt > buf_us + buf_us/2) late++;
+		if (dt > buf_us*(desc_num-1)) underruns++;
+	}
+	last_us = now;
+	fills++;
+
 	// size_t load_bytes = 0;
-	portENTER_CRITICAL_ISR(&spinlock);
-	if (aidx < asize) {
-		uint32_t idx = aidx;
-		uint32_t size = (!cyclic && asize < sizeof(buf)) ? asize : sizeof(buf);
-		aidx =  cyclic ? (aidx + size) % asize : aidx + size;
-		portEXIT_CRITICAL_ISR(&spinlock);
-		uint32_t i;
-		for (i = 0; i < size; i++) buf[i] = abase[(idx+i)%asize]*volume/PERCENT + bias;
-		while (i < sizeof(buf)) buf[i++] = SILENCE; // pad to block size with silence
-		dac_continuous_write_asynchronously(handle,
-			event->buf, event->buf_size,
-			buf, sizeof(buf), NULL /*&load_bytes*/);
-			// error if load_bytes != sizeof(buf)
+	bool woken = false;
+	if (sound_mix_fill(dbuf, n, &woken, true)) {
+		dcnt = desc_num;
 	} else if (dcnt) {
-		dcnt--;
-		portEXIT_CRITICAL_ISR(&spinlock);
-		memset(buf, SILENCE, sizeof(buf));
-		dac_continuous_write_asynchronously(handle,
-			event->buf, event->buf_size,
-			buf, sizeof(buf), NULL /*&load_bytes*/);
+		dcnt--; // flush all DMA buffers with silence
 	} else {
-		portEXIT_CRITICAL_ISR(&spinlock);
+		n = 0;
 	}
-	return false; // no high priority task awoken
+	if (n) dac_continuous_write_asynchronously(handle,
+		event->buf, event->buf_size,
+		dbuf, n, NULL /*&load_bytes*/);
+		// error if load_bytes != n
+	uint32_t t = esp_timer_get_time() - now;
+	if (t > fill_max_us) fill_max_us = t;
+	return woken; // true if high priority task awoken
 }
 
 
 // Initialize the sound driver. Must be called before using sound.
-// May be called again to change sample rate.
+// May be called again to change sample rate. The volume is set to the
+// default by the first call only.
 // sample_hz: sample rate in Hz to playback audio.
 // Return zero if successful, or non-zero otherwise.
 int32_t sound_init(uint32_t sample_hz)
 {
-	sound_set_volume(SOUND_VOLUME_DEFAULT);
+	if (sample_hz == 0) return 1;
+	// Samples already in the other DMA buffers play before a refill
+	buf_us = BUF_SAMPLES(buf_size)*US_PER_S/sample_hz;
+	sound_mix_init(sample_hz, buf_us*(desc_num-1));
+	rate = sample_hz;
 	
 	/* * * * * * * * * * GPIO25 Pin Config * * * * * * * * * */
 	// if the first time called, configure GPIO25 as output
@@ -110,8 +118,8 @@ int32_t sound_init(uint32_t sample_hz)
 	}
 	dac_continuous_config_t cont_cfg = {
 		.chan_mask = DAC_CHANNEL_MASK_CH1, // GPIO26 only
-		.desc_num = DAC_DESC_NUM,
-		.buf_size = DAC_BUF_SZ,
+		.desc_num = desc_num,
+		.buf_size = buf_size,
 		.freq_hz = sample_hz,
 		.offset = 0,
 		.clk_src = DAC_DIGI_CLK_SRC_DEFAULT,
@@ -136,6 +144,7 @@ int32_t sound_init(uint32_t sample_hz)
 	// Register the callback for asynchronous writing
 	ESP_ERROR_CHECK(dac_continuous_register_event_callback(dac_handle, &cbs, NULL));
 	// Enable the continuous channels
+	sound_stats_reset();
 	ESP_ERROR_CHECK(dac_continuous_enable(dac_handle));
 	ESP_LOGI(TAG, "Start async audio DMA");
 	ESP_ERROR_CHECK(dac_continuous_start_async_writing(dac_handle));
@@ -156,64 +165,48 @@ int32_t sound_deinit(void)
 	return 0;
 }
 
-// Start playing the sound immediately. Play the audio buffer once.
-// audio: a pointer to an array of unsigned audio data.
-// size: the size of the array in bytes.
-// wait: if true, block until done playing, otherwise return straight away.
-void sound_start(const void *audio, uint32_t size, bool wait)
-{
-	portENTER_CRITICAL(&spinlock);
-	abase = audio;
-	asize = size;
-	aidx = 0;
-	cyclic = false;
-	dcnt = DAC_DESC_NUM;
-	portEXIT_CRITICAL(&spinlock);
-	while (wait && aidx < asize)
-		vTaskDelay(pdMS_TO_TICKS(POLL_DELAY));
-}
-
-// Cyclically play samples from audio buffer until sound_stop() is called.
-// audio: a pointer to an array of unsigned audio data.
-// size: the size of the array in bytes.
-void sound_cyclic(const void *audio, uint32_t size)
-{
-	portENTER_CRITICAL(&spinlock);
-	abase = audio;
-	asize = size;
-	aidx = 0;
-	cyclic = true;
-	dcnt = DAC_DESC_NUM;
-	portEXIT_CRITICAL(&spinlock);
-}
-
-// Return true if sound playing, otherwise return false.
-bool sound_busy(void)
+// Enable or disable the sound output device.
+// enable: if true, enable sound, otherwise disable.
+void sound_device(bool enable)
 {
-	return aidx < asize;
+	gpio_set_level(SOUND_EN, device_en = enable);
 }
 
-// Stop playing the sound.
-void sound_stop(void)
+// Set the number and size of the DMA buffers. Fewer and smaller buffers
+// lower the latency, but refill callbacks must then be more timely.
+// If the driver is initialized, it is restarted with the new settings.
+// desc_num: number of DMA buffers (SOUND_DESC_MIN to SOUND_DESC_MAX).
+// buf_size: size of each DMA buffer in bytes (SOUND_BUF_MIN to SOUND_BUF_MAX).
+// Return zero if successful, or non-zero otherwise.
+int32_t sound_config(uint32_t desc, uint32_t size)
 {
-	portENTER_CRITICAL(&spinlock);
-	aidx = asize;
-	portEXIT_CRITICAL(&spinlock);
+	if (desc < SOUND_DESC_MIN || desc > SOUND_DESC_MAX ||
+		size < SOUND_BUF_MIN || size > SOUND_BUF_MAX) return 1;
+	desc_num = desc;
+	buf_size = size;
+	return (dac_handle != NULL) ? sound_init(rate) : 0;
 }
 
-// Set the volume.
-// volume: 0-100% as an integer value.
-void sound_set_volume(uint32_t vol)
+// Get the driver statistics.
+// *stats: pointer to structure that receives the statistics.
+void sound_stats(sound_stats_t *stats)
 {
-	volume = vol;
-	bias = SILENCE - (SILENCE * vol / PERCENT);
+	stats->desc_num = desc_num;
+	stats->buf_size = buf_size;
+	stats->buf_us = buf_us;
+	stats->fills = fills;
+	stats->late = late;
+	stats->underruns = underruns;
+	stats->fill_max_us = fill_max_us;
+	sound_mix_stats(stats);
 }
 
-// Enable or disable the sound output device.
-// enable: if true, enable sound, otherwise disable.
-void sound_device(bool enable)
+// Clear the driver statistics.
+void sound_stats_reset(void)
 {
-	gpio_set_level(SOUND_EN, device_en = enable);
+	last_us = 0;
+	fills = late = underruns = fill_max_us = 0;
+	sound_mix_stats_reset();
 }
 
 // NOTES:
@@ -0,0 +1,154 @@
+// Host (Linux) stand-in for the DAC continuous driver in sound_cont.c.
+// The refill path in sound_mix.c is called the same way the DMA callback
+// calls it, one DAC buffer at a time, and the output is saved to a file.
+
+#include <stdio.h>
+#include <string.h>
+
+#include "sound.h"
+#include "sound_mix.h"
+#include "sound_host.h"
+
+#define DAC_DESC_NUM 8 // Default number of DAC descriptors
+#define DAC_BUF_SZ 128 // Default DAC buffer size in bytes
+#define US_PER_S 1000000ULL
+
+
+#define WAV_HDR_SZ 44
+#define WAV_FMT_SZ 16
+#define WAV_PCM 1
+#define WAV_BITS 8
+
+// Global variables
+static uint32_t rate; // Sample rate in Hz, zero if not initialized
+static bool device_en;
+static uint32_t desc_num = DAC_DESC_NUM;
+static uint32_t buf_size = DAC_BUF_SZ;
+static uint32_t fills;
+
+
+// Write a little endian value of n bytes.
+static void put_le(uint8_t *p, uint32_t val, uint32_t n)
+{
+	for (uint32_t i = 0; i < n; i++, val >>= 8) p[i] = val & 0xFF;
+}
+
+// Write the WAV file header for the given number of samples.
+static void wav_header(FILE *fp, uint32_t samples)
+{
+	uint8_t h[WAV_HDR_SZ];
+	memcpy(h, "RIFF", 4);
+	put_le(h+4, WAV_HDR_SZ - 8 + samples, 4);
+	memcpy(h+8, "WAVEfmt ", 8);
+	put_le(h+16, WAV_FMT_SZ, 4);
+	put_le(h+20, WAV_PCM, 2);
+	put_le(h+22, 1, 2); // channels
+	put_le(h+24, rate, 4);
+	put_le(h+28, rate, 4); // bytes per second
+	put_le(h+32, 1, 2); // block align
+	put_le(h+34, WAV_BITS, 2);
+	memcpy(h+36, "data", 4);
+	put_le(h+40, samples, 4);
+	fseek(fp, 0, SEEK_SET);
+	fwrite(h, 1, sizeof(h), fp);
+}
+
+// Initialize the sound driver. Must be called before using sound.
+// May be called again to change sample rate. The volume is set to the
+// default by the first call only.
+// sample_hz: sample rate in Hz to playback audio.
+// Return zero if successful, or non-zero otherwise.
+int32_t sound_init(uint32_t sample_hz)
+{
+	if (sample_hz == 0) return 1;
+	// Samples already in the other DMA buffers play before a refill
+	sound_mix_init(sample_hz, buf_size*US_PER_S/sample_hz*(desc_num-1));
+	sound_stats_reset();
+	rate = sample_hz;
+	device_en = true;
+	return 0;
+}
+
+// Free resources used for sound (DAC, etc.).
+// Return zero if successful, or non-zero otherwise.
+int32_t sound_deinit(void)
+{
+	rate = 0;
+	return 0;
+}
+
+// Enable or disable the sound output device.
+// enable: if true, enable sound, otherwise disable.
+void sound_device(bool enable)
+{
+	device_en = enable;
+}
+
+// Set the number and size of the DMA buffers. The rendered output is the
+// same for any configuration, only the reported latency changes.
+// desc_num: number of DMA buffers (SOUND_DESC_MIN to SOUND_DESC_MAX).
+// buf_size: size of each DMA buffer in bytes (SOUND_BUF_MIN to SOUND_BUF_MAX).
+// Return zero if successful, or non-zero otherwise.
+int32_t sound_config(uint32_t desc, uint32_t size)
+{
+	if (desc < SOUND_DESC_MIN || desc > SOUND_DESC_MAX ||
+		size < SOUND_BUF_MIN || size > SOUND_BUF_MAX) return 1;
+	desc_num = desc;
+	buf_size = size;
+	return rate ? sound_init(rate) : 0;
+}
+
+// Get the driver statistics. Rendering is not real time, so no refill
+// is ever late.
+// *stats: pointer to structure that receives the statistics.
+void sound_stats(sound_stats_t *stats)
+{
+	stats->desc_num = desc_num;
+	stats->buf_size = buf_size;
+	stats->buf_us = rate ? buf_size*US_PER_S/rate : 0;
+	stats->fills = fills;
+	stats->late = stats->underruns = stats->fill_max_us = 0;
+	sound_mix_stats(stats);
+}
+
+// Clear the driver statistics.
+void sound_stats_reset(void)
+{
+	fills = 0;
+	sound_mix_stats_reset();
+}
+
+// Render samples of sound output to a WAV file.
+// path: file name of the WAV file to create.
+// samples: number of samples to render, or zero to render until nothing
+// is playing (limited to SOUND_HOST_MAX_SEC seconds).
+// Return the number of samples written, or a negative value on error.
+int32_t sound_host_render(const char *path, uint32_t samples)
+{
+	if (rate == 0) return -1;
+	FILE *fp = fopen(path, "wb");
+	if (fp == NULL) return -1;
+	wav_header(fp, 0);
+
+	uint8_t buf[SOUND_BUF_MAX];
+	uint32_t max = samples ? samples : rate*SOUND_HOST_MAX_SEC;
+	uint32_t total = 0, dcnt = desc_num;
+	while (total < max) {
+		bool woken = false;
+		fills++;
+		if (sound_mix_fill(buf, buf_size, &woken, true)) {
+			dcnt = desc_num;
+		} else if (dcnt) {
+			dcnt--; // flush all DMA buffers with silence
+		} else if (!samples) {
+			break;
+		}
+		if (!device_en) memset(buf, SILENCE, buf_size); // amplifier off
+		uint32_t n = (max - total < buf_size) ? max - total : buf_size;
+		fwrite(buf, 1, n, fp);
+		total += n;
+	}
+	wav_header(fp, total);
+	if (fclose(fp)) return -1;
+	return total;
+}
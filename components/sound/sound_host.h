@@ -0,0 +1,20 @@
+#ifndef SOUND_HOST_H_
+#define SOUND_HOST_H_
+
+#include <stdint.h>
+
+// Host (Linux) stand-in for the DAC driver. Instead of a DMA engine
+// calling the refill path, sound_host_render() calls it repeatedly and
+// writes the samples that would go to the DAC into a WAV file (8-bit
+// unsigned, mono, at the rate given to sound_init()).
+
+// Render samples of sound output to a WAV file.
+// path: file name of the WAV file to create.
+// samples: number of samples to render, or zero to render until nothing
+// is playing (limited to SOUND_HOST_MAX_SEC seconds).
+// Return the number of samples written, or a negative value on error.
+int32_t sound_host_render(const char *path, uint32_t samples);
+
+#define SOUND_HOST_MAX_SEC 60
+
+#endif // SOUND_HOST_H_
@@ -0,0 +1,569 @@
+// Refill path shared by the sound drivers. The audio buffer and the
+// generator are mixed here so that both drivers behave the same.
+
+#include <string.h> // memcpy, memset
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "esp_attr.h"
+#include "esp_timer.h"
+
+#include "sound.h"
+#include "sound_mix.h"
+
+// Make audio buffer extern for testing
+#ifdef EXTERN_BUF
+#define scope
+#else
+#define scope static
+#endif
+
+#define PERCENT 100U
+#define GEN_BLK 32 // Generator block size in samples
+#define SAMPLE_MAX 255
+#define FRAC_BITS 16 // Fractional bits of the resampler position
+#define FRAC_MASK ((1U << FRAC_BITS) - 1)
+#define STEP_ONE (1U << FRAC_BITS) // Clip rate equals output rate
+#define TUNE_STARTUP_MS 50 // Settling time before measuring a configuration
+#define TASK_RING_SZ SOUND_TASK_LEAD // Sound task ring size, a power of two
+#define TASK_BLK 64 // Samples the sound task mixes at a time
+#define TASK_STACK 3072
+#define US_PER_S 1000000ULL
+#define CLIP(x,lo,hi) ((x) < (lo) ? (lo) : ((x) > (hi) ? (hi) : (x)))
+
+typedef struct {
+	const uint8_t *base;
+	uint32_t size;
+	uint32_t step; // Clip samples per output sample (Q16)
+} clip_t;
+
+// Critical section protected variables
+static portMUX_TYPE spinlock = portMUX_INITIALIZER_UNLOCKED;
+scope  const uint8_t *abase;
+scope  volatile uint32_t asize;
+static volatile uint32_t aidx;
+static uint32_t afrac; // Fraction of a sample past aidx (Q16)
+static uint32_t astep; // Clip samples per output sample (Q16)
+static volatile bool     cyclic;
+static clip_t queue[SOUND_QUEUE_LEN]; // Clips that follow the current one
+static uint32_t qhead, qtail, qcnt;
+static uint32_t aseq; // incremented each time a task replaces the clip
+static SemaphoreHandle_t waiter; // Of a task blocked in sound_start()
+static sound_gen_t gen;
+static void *garg;
+static uint32_t gseq; // incremented each time a generator is started
+static int64_t start_us; // Time the current clip was started by a task
+static bool lat_pend; // Latency of the current clip not yet measured
+
+// Generator block, only accessed from the refill path
+static uint8_t gbuf[GEN_BLK];
+static uint32_t glen; // Valid samples in gbuf
+static uint32_t gidx; // Next sample in gbuf
+static uint32_t gcur; // gseq of the generator that filled gbuf
+
+// Other global variables
+static uint32_t out_hz; // Output sample rate in Hz
+static volatile sound_cb_t callback;
+static void *volatile cb_arg;
+static volatile uint32_t volume;
+static volatile uint8_t bias; // to prevent popping at end when vol low.
+static uint32_t queue_us; // Time filled samples wait in the driver
+static volatile uint32_t lat_us, lat_max_us; // Measured start latency
+static ring_t *volatile stream; // Samples from a feeder, drained lock-free
+static uint32_t tap_cnt; // Samples since the last one kept by the tap
+
+// Sound task that mixes ahead of the driver, see sound_task()
+static TaskHandle_t task;
+static volatile bool task_on; // Driver reads from the task ring
+static uint8_t task_buf[TASK_RING_SZ];
+static ring_t task_ring;
+static uint32_t task_wr; // Samples written to the ring
+static volatile uint32_t task_rd; // Samples read from the ring
+static uint32_t task_end; // task_wr after the last sample of a clip
+
+
+// Initialize state shared with the refill path. Called by sound_init().
+// The volume is set to SOUND_VOLUME_DEFAULT on the first call only, so a
+// restart of the driver (sound_config(), sound_autotune()) keeps it.
+// sample_hz: output sample rate in Hz.
+// delay_us: time that filled samples wait in the driver before output.
+void sound_mix_init(uint32_t sample_hz, uint32_t delay_us)
+{
+	if (out_hz == 0) sound_set_volume(SOUND_VOLUME_DEFAULT);
+	out_hz = sample_hz;
+	queue_us = delay_us;
+}
+
+// Add the latency measured by the refill path to the driver statistics.
+// *stats: latency_us and latency_max_us are set.
+void sound_mix_stats(sound_stats_t *stats)
+{
+	stats->latency_us = lat_us;
+	stats->latency_max_us = lat_max_us;
+}
+
+// Clear the latency measured by the refill path.
+void sound_mix_stats_reset(void)
+{
+	lat_us = lat_max_us = 0;
+}
+
+// Return the resampler step for a clip recorded at sample_hz.
+static uint32_t clip_step(uint32_t sample_hz)
+{
+	if (sample_hz == 0 || out_hz == 0) return STEP_ONE;
+	uint32_t step = ((uint64_t)sample_hz << FRAC_BITS) / out_hz;
+	return step ? step : 1;
+}
+
+// Copy clip samples to buf, converting the clip rate to the output rate
+// by linear interpolation. Works on a copy of the clip position, so it
+// runs outside the critical section.
+// *c: clip to copy from.
+// cyc: true if the clip plays cyclically.
+// *idx, *frac: position in the clip, advanced past the samples copied.
+// Return the number of samples written.
+static uint32_t IRAM_ATTR clip_fill(uint8_t *buf, uint32_t size,
+	const clip_t *c, bool cyc, uint32_t *idx, uint32_t *frac)
+{
+	uint32_t cnt = 0, i = *idx, f = *frac;
+	if (c->step == STEP_ONE && f == 0) {
+		cnt = c->size - i;
+		if (cnt > size) cnt = size;
+		memcpy(buf, c->base+i, cnt);
+		*idx = i + cnt;
+		return cnt;
+	}
+	while (cnt < size && i < c->size) {
+		int32_t s0 = c->base[i];
+		int32_t s1 = (i+1 < c->size) ? c->base[i+1] : (cyc ? c->base[0] : s0);
+		buf[cnt++] = s0 + (((s1 - s0) * (int32_t)f) >> FRAC_BITS);
+		f += c->step;
+		i += f >> FRAC_BITS;
+		f &= FRAC_MASK;
+	}
+	*idx = i;
+	*frac = f;
+	return cnt;
+}
+
+// Enter the critical section from the driver's ISR or the sound task.
+static inline void IRAM_ATTR mix_lock(bool isr)
+{
+	if (isr) portENTER_CRITICAL_ISR(&spinlock);
+	else portENTER_CRITICAL(&spinlock);
+}
+
+// Exit the critical section entered by mix_lock().
+static inline void IRAM_ATTR mix_unlock(bool isr)
+{
+	if (isr) portEXIT_CRITICAL_ISR(&spinlock);
+	else portEXIT_CRITICAL(&spinlock);
+}
+
+// Mix size output samples into buf, scaled by the volume. Samples are
+// mixed from the audio buffer (sound_start/sound_cyclic/sound_enqueue)
+// the generator (sound_generate) and the stream (sound_stream). Called
+// from the driver's ISR, or from the sound task if it is running.
+// *woken: set true if a higher priority task was woken, else unchanged.
+// isr: true if called from the ISR, false if from the sound task (buf is
+// then the next TASK_BLK samples of the task ring).
+// Return the number of samples that came from an active source, or zero
+// if nothing is playing (buf is then all SILENCE).
+static uint32_t IRAM_ATTR mix(uint8_t *buf, uint32_t size, bool *woken, bool isr)
+{
+	const void *ended[SOUND_QUEUE_LEN+1]; // Clips that ended in this fill
+	uint32_t nend = 0, cnt = 0;
+	SemaphoreHandle_t wake = NULL;
+	BaseType_t hpw = pdFALSE;
+	sound_gen_t g;
+	void *a;
+	uint32_t seq;
+
+	mix_lock(isr);
+	if (lat_pend && aidx < asize) { // first samples of a started clip
+		lat_pend = false;
+		lat_us = esp_timer_get_time() - start_us + queue_us;
+		if (task_on) lat_us += ring_count(&task_ring)*US_PER_S/out_hz;
+		if (lat_us > lat_max_us) lat_max_us = lat_us;
+	}
+	g = gen;
+	a = garg;
+	seq = gseq;
+	if (seq != gcur) {
+		glen = gidx = GEN_BLK; // request a new block
+		gcur = seq;
+	}
+	// Only the clip position is read and published under the lock, the
+	// copy and resampling run with interrupts enabled
+	while (cnt < size && aidx < asize) {
+		clip_t c = {abase, asize, astep};
+		uint32_t idx = aidx, frac = afrac, cseq = aseq;
+		bool cyc = cyclic;
+		mix_unlock(isr);
+		uint32_t n = clip_fill(buf+cnt, size-cnt, &c, cyc, &idx, &frac);
+		mix_lock(isr);
+		if (cseq != aseq) continue; // replaced by a task, fill again
+		cnt += n;
+		aidx = idx;
+		afrac = frac;
+		if (aidx < asize) break;
+		if (cyclic) {
+			aidx %= asize;
+		} else if (qcnt) { // continue with the next clip, no gap
+			if (nend < SOUND_QUEUE_LEN+1) ended[nend++] = abase;
+			abase = queue[qhead].base;
+			asize = queue[qhead].size;
+			astep = queue[qhead].step;
+			aidx = afrac = 0;
+			qhead = (qhead + 1) % SOUND_QUEUE_LEN;
+			qcnt--;
+		} else {
+			aidx = asize; // resampler may step past the end
+			if (nend < SOUND_QUEUE_LEN+1) ended[nend++] = abase;
+			wake = waiter;
+			waiter = NULL;
+			if (!isr) task_end = task_wr + cnt;
+		}
+	}
+	mix_unlock(isr);
+	memset(buf+cnt, SILENCE, size-cnt);
+	if (wake != NULL) {
+		if (isr) xSemaphoreGiveFromISR(wake, &hpw);
+		else xSemaphoreGive(wake);
+	}
+
+	sound_cb_t cb = callback;
+	for (uint32_t i = 0; cb != NULL && i < nend; i++)
+		if (cb(ended[i], cb_arg)) hpw = pdTRUE;
+	if (hpw == pdTRUE) *woken = true;
+
+	ring_t *st = stream;
+	const uint8_t *sp = NULL;
+	uint32_t sn = 0, sused = 0; // Samples left and used in the stream chunk
+	uint32_t gcnt = 0, scnt = 0;
+	uint32_t tdec = sound_tap_dec, tidx = sound_tap_idx;
+	for (uint32_t i = 0; i < size; i++) {
+		int32_t s = buf[i] - (int32_t)SILENCE; // signed, centered on zero
+		if (st != NULL) {
+			if (sn == 0) { // the ring data wraps at most once
+				ring_read_commit(st, sused);
+				sused = 0;
+				sn = ring_read_ptr(st, &sp);
+				if (sn == 0) st = NULL; // empty, rest is silence
+			}
+			if (sn) {
+				s += sp[sused++] - (int32_t)SILENCE;
+				sn--;
+				scnt++;
+			}
+		}
+		if (g != NULL) {
+			if (gidx == glen && glen == GEN_BLK) {
+				glen = g(gbuf, GEN_BLK, a);
+				gidx = 0;
+			}
+			if (gidx < glen) {
+				s += gbuf[gidx++] - (int32_t)SILENCE;
+				gcnt++;
+			} else { // generator finished
+				mix_lock(isr);
+				if (gseq == seq) gen = NULL;
+				mix_unlock(isr);
+				g = NULL;
+			}
+		}
+		s = CLIP(s + (int32_t)SILENCE, 0, SAMPLE_MAX);
+		buf[i] = s*volume/PERCENT + bias;
+		if (tdec && ++tap_cnt >= tdec) {
+			tap_cnt = 0;
+			sound_tap_buf[tidx++ & (SOUND_TAP_LEN-1)] = buf[i];
+		}
+	}
+	sound_tap_idx = tidx;
+	if (st != NULL) ring_read_commit(st, sused);
+	if (gcnt > cnt) cnt = gcnt;
+	return (scnt > cnt) ? scnt : cnt;
+}
+
+// Fill buf with size output samples. Called from the driver's ISR or
+// refill task. If the sound task is running, the samples it mixed ahead
+// are copied, otherwise they are mixed here.
+// *woken: set true if a higher priority task was woken, else unchanged.
+// isr: true if called from an ISR, false if from a task.
+// Return the number of samples that came from an active source, or zero
+// if nothing is playing (buf is then all SILENCE).
+uint32_t IRAM_ATTR sound_mix_fill(uint8_t *buf, uint32_t size, bool *woken, bool isr)
+{
+	if (!task_on) return mix(buf, size, woken, isr);
+	BaseType_t hpw = pdFALSE;
+	uint32_t n = ring_read(&task_ring, buf, size);
+	task_rd += n;
+	memset(buf+n, SILENCE, size-n);
+	if (isr) vTaskNotifyGiveFromISR(task, &hpw); // mix more
+	else xTaskNotifyGive(task);
+	if (hpw == pdTRUE) *woken = true;
+	return n;
+}
+
+// Sound task. Keep the ring full of mixed samples. Blocks are only
+// added while a source is active, so the driver sees the ring run empty
+// when sound ends, the same as when it mixes itself.
+static void sound_task_loop(void *arg)
+{
+	vTaskDelay(1); // let a refill in progress in the ISR finish
+	for (;;) {
+		uint8_t *p;
+		bool woken = false;
+		while (ring_write_ptr(&task_ring, &p) >= TASK_BLK &&
+			mix(p, TASK_BLK, &woken, false)) {
+			ring_write_commit(&task_ring, TASK_BLK);
+			task_wr += TASK_BLK;
+		}
+		if (woken) taskYIELD();
+		ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+	}
+}
+
+// Wake the sound task to mix a sound that was just started.
+static inline void sound_task_kick(void)
+{
+	if (task_on) xTaskNotifyGive(task);
+}
+
+// Start playing the sound immediately. Play the audio buffer once.
+// audio: a pointer to an array of unsigned audio data.
+// size: the size of the array in bytes.
+// wait: if true, block until done playing, stopped or replaced by another
+// sound, otherwise return straight away.
+void sound_start(const void *audio, uint32_t size, bool wait)
+{
+	sound_start_hz(audio, size, 0, wait);
+}
+
+// Start playing the sound immediately. Play the audio buffer once,
+// converting it from its sample rate to the output sample rate.
+// audio: a pointer to an array of unsigned audio data.
+// size: the size of the array in bytes.
+// sample_hz: sample rate in Hz of the audio data, zero for output rate.
+// wait: if true, block until done playing, stopped or replaced by another
+// sound, otherwise return straight away.
+void sound_start_hz(const void *audio, uint32_t size, uint32_t sample_hz, bool wait)
+{
+	uint32_t step = clip_step(sample_hz);
+	int64_t now = esp_timer_get_time();
+	StaticSemaphore_t sem_buf;
+	SemaphoreHandle_t sem = NULL, prev;
+	wait = wait && size && out_hz; // nothing plays before sound_init()
+	if (wait) sem = xSemaphoreCreateBinaryStatic(&sem_buf);
+	portENTER_CRITICAL(&spinlock);
+	start_us = now;
+	lat_pend = true;
+	abase = audio;
+	asize = size;
+	aidx = afrac = 0;
+	astep = step;
+	cyclic = false;
+	qhead = qtail = qcnt = 0;
+	aseq++;
+	prev = waiter;
+	waiter = sem;
+	portEXIT_CRITICAL(&spinlock);
+	if (prev != NULL) xSemaphoreGive(prev); // its clip was replaced
+	sound_task_kick();
+	if (wait) {
+		xSemaphoreTake(sem, portMAX_DELAY);
+		vSemaphoreDelete(sem);
+	}
+}
+
+// Queue an audio buffer to play once after those already playing or
+// queued, without a gap. If nothing is playing, it starts immediately.
+// audio: a pointer to an array of unsigned audio data.
+// size: the size of the array in bytes.
+// Return zero if successful, or non-zero if the queue is full.
+int32_t sound_enqueue(const void *audio, uint32_t size)
+{
+	return sound_enqueue_hz(audio, size, 0);
+}
+
+// Queue an audio buffer to play once after those already playing or
+// queued, converting it from its sample rate to the output sample rate.
+// audio: a pointer to an array of unsigned audio data.
+// size: the size of the array in bytes.
+// sample_hz: sample rate in Hz of the audio data, zero for output rate.
+// Return zero if successful, or non-zero if the queue is full.
+int32_t sound_enqueue_hz(const void *audio, uint32_t size, uint32_t sample_hz)
+{
+	uint32_t step = clip_step(sample_hz);
+	int64_t now = esp_timer_get_time();
+	SemaphoreHandle_t prev = NULL;
+	int32_t err = 0;
+	if (size == 0) return 0;
+	portENTER_CRITICAL(&spinlock);
+	if (aidx >= asize) {
+		start_us = now;
+		lat_pend = true;
+		abase = audio;
+		asize = size;
+		aidx = afrac = 0;
+		astep = step;
+		cyclic = false;
+		aseq++;
+		prev = waiter;
+		waiter = NULL;
+	} else if (qcnt < SOUND_QUEUE_LEN) {
+		queue[qtail].base = audio;
+		queue[qtail].size = size;
+		queue[qtail].step = step;
+		qtail = (qtail + 1) % SOUND_QUEUE_LEN;
+		qcnt++;
+	} else {
+		err = -1;
+	}
+	portEXIT_CRITICAL(&spinlock);
+	if (prev != NULL) xSemaphoreGive(prev);
+	sound_task_kick();
+	return err;
+}
+
+// Cyclically play samples from audio buffer until sound_stop() is called.
+// audio: a pointer to an array of unsigned audio data.
+// size: the size of the array in bytes.
+void sound_cyclic(const void *audio, uint32_t size)
+{
+	int64_t now = esp_timer_get_time();
+	SemaphoreHandle_t prev;
+	portENTER_CRITICAL(&spinlock);
+	start_us = now;
+	lat_pend = true;
+	abase = audio;
+	asize = size;
+	aidx = afrac = 0;
+	astep = STEP_ONE;
+	cyclic = true;
+	qhead = qtail = qcnt = 0;
+	aseq++;
+	prev = waiter;
+	waiter = NULL;
+	portEXIT_CRITICAL(&spinlock);
+	if (prev != NULL) xSemaphoreGive(prev); // its clip was replaced
+	sound_task_kick();
+}
+
+// Return true if sound playing, otherwise return false. With the sound
+// task running, the end of a clip may still be in its ring.
+bool sound_busy(void)
+{
+	bool busy;
+	portENTER_CRITICAL(&spinlock);
+	busy = aidx < asize || (task_on && (int32_t)(task_end - task_rd) > 0);
+	portEXIT_CRITICAL(&spinlock);
+	return busy;
+}
+
+// Stop playing the sound.
+void sound_stop(void)
+{
+	SemaphoreHandle_t prev;
+	portENTER_CRITICAL(&spinlock);
+	aidx = asize;
+	qhead = qtail = qcnt = 0;
+	aseq++;
+	prev = waiter;
+	waiter = NULL;
+	portEXIT_CRITICAL(&spinlock);
+	if (prev != NULL) xSemaphoreGive(prev);
+}
+
+// Set a function to call each time an audio buffer finishes playing.
+// cb: callback function, or NULL for none.
+// arg: argument passed to each call of the callback.
+void sound_set_callback(sound_cb_t cb, void *arg)
+{
+	portENTER_CRITICAL(&spinlock);
+	callback = cb;
+	cb_arg = arg;
+	portEXIT_CRITICAL(&spinlock);
+}
+
+// Start a generator that plays in the background, mixed with any audio
+// buffer started with sound_start() or sound_cyclic().
+// gen: generator function, or NULL to stop the current generator.
+// arg: argument passed to each call of the generator.
+void sound_generate(sound_gen_t g, void *arg)
+{
+	portENTER_CRITICAL(&spinlock);
+	gen = g;
+	garg = arg;
+	gseq++; // a finishing generator will not clear this one
+	portEXIT_CRITICAL(&spinlock);
+	sound_task_kick();
+}
+
+// Return true if a generator is running, otherwise return false.
+bool sound_generating(void)
+{
+	return gen != NULL;
+}
+
+// Find the lowest latency buffer configuration that has no late refill
+// callbacks while the application runs its normal load (e.g., display
+// updates from another task). Configurations are tried in order of
+// increasing latency, each for the given time. The driver must be
+// initialized. Sound output is interrupted while tuning.
+// ms: time in milliseconds to measure each configuration.
+// Return zero if a configuration was found, or non-zero otherwise
+// (the configuration is then restored).
+int32_t sound_autotune(uint32_t ms)
+{
+	static const struct {uint16_t desc, size;} cfg[] = {
+		{2, 32}, {3, 32}, {2, 64}, {4, 32}, {3, 64}, {4, 64},
+		{3, 128}, {4, 128}, {6, 128}, {8, 128}, {8, 256},
+	};
+	sound_stats_t st, orig;
+	if (out_hz == 0) return 1;
+	sound_stats(&orig);
+	for (uint32_t i = 0; i < sizeof(cfg)/sizeof(cfg[0]); i++) {
+		if (sound_config(cfg[i].desc, cfg[i].size)) continue; // not supported
+		vTaskDelay(pdMS_TO_TICKS(TUNE_STARTUP_MS));
+		sound_stats_reset();
+		vTaskDelay(pdMS_TO_TICKS(ms));
+		sound_stats(&st);
+		if (st.fills && !st.late && !st.underruns) return 0;
+	}
+	sound_config(orig.desc_num, orig.buf_size);
+	return 1;
+}
+
+// Mix samples from a ring buffer that a feeder task fills.
+// ring: ring of unsigned samples at the output rate, or NULL to stop.
+void sound_stream(ring_t *ring)
+{
+	stream = ring;
+	sound_task_kick();
+}
+
+// Mix in a task pinned to a core, rendering ahead into a ring so that
+// the driver's ISR only copies samples. The ring adds latency.
+// core: core to run the task on.
+// priority: task priority.
+// Return zero if successful, or non-zero otherwise.
+int32_t sound_task(uint32_t core, uint32_t priority)
+{
+	if (task != NULL) return 0;
+	ring_init(&task_ring, task_buf, sizeof(task_buf));
+	if (xTaskCreatePinnedToCore(sound_task_loop, "sound", TASK_STACK, NULL,
+		priority, &task, core) != pdPASS) return 1;
+	task_on = true;
+	return 0;
+}
+
+// Set the volume.
+// volume: 0-100% as an integer value.
+void sound_set_volume(uint32_t vol)
+{
+	volume = vol;
+	bias = SILENCE - (SILENCE * vol / PERCENT);
+}
@@ -0,0 +1,45 @@
+#ifndef SOUND_MIX_H_
+#define SOUND_MIX_H_
+
+// Private interface between the sound drivers (sound_one.c, sound_cont.c)
+// and the shared refill path in sound_mix.c. The drivers own the DAC and
+// the sample clock; the mixer owns the audio sources and the volume.
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "sound.h" // sound_stats_t
+
+#define SILENCE 0x80U
+#define SOUND_VOLUME_DEFAULT 50
+
+// Initialize state shared with the refill path. Called by sound_init().
+// The volume is set to SOUND_VOLUME_DEFAULT on the first call only, so a
+// restart of the driver (sound_config(), sound_autotune()) keeps it.
+// sample_hz: output sample rate in Hz.
+// delay_us: time that filled samples wait in the driver before output.
+void sound_mix_init(uint32_t sample_hz, uint32_t delay_us);
+
+// Fill buf with size output samples, scaled by the volume. Samples are
+// mixed from the audio buffer (sound_start/sound_cyclic/sound_enqueue)
+// the generator (sound_generate) and the stream (sound_stream). Called
+// from the driver's ISR or refill task.
+// *woken: set true if a higher priority task was woken, else unchanged.
+// isr: true if called from an ISR, false if from a task.
+// Return the number of samples that came from an active source, or zero
+// if nothing is playing (buf is then all SILENCE).
+uint32_t sound_mix_fill(uint8_t *buf, uint32_t size, bool *woken, bool isr);
+
+// Visualization tap, written by the refill path and read in sound_tap.c
+extern uint8_t sound_tap_buf[SOUND_TAP_LEN];
+extern volatile uint32_t sound_tap_idx; // Next write, free running
+extern volatile uint32_t sound_tap_dec; // Decimation, zero if off
+
+// Add the latency measured by the refill path to the driver statistics.
+// *stats: latency_us and latency_max_us are set.
+void sound_mix_stats(sound_stats_t *stats);
+
+// Clear the latency measured by the refill path.
+void sound_mix_stats_reset(void);
+
+#endif // SOUND_MIX_H_
@@ -5,74 +5,143 @@
 
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
+#include "freertos/semphr.h"
 #include "esp_log.h"
 #include "esp_check.h"
+#include "esp_timer.h"
 #include "driver/gpio.h"
 #include "driver/gptimer.h"
 #include "driver/dac_oneshot.h"
 
 #include "hw.h"
 #include "sound.h"
-
-// Make audio buffer extern for testing
-#ifdef EXTERN_BUF
-#define scope
-#else
-#define scope static
-#endif
+#include "sound_mix.h"
 
 #define SOUND_A  HW_SND_A  // Audio output
 #define SOUND_EN HW_SND_EN // Sound enable, active high
 
 #define GPTIMER_RESOLUTION_HZ 1000000
 
-#define SOUND_VOLUME_DEFAULT 50
-#define SILENCE 0x80U
-#define POLL_DELAY 10
-#define PERCENT 100U
 
 static const char *TAG = "sound";
 
-// Critical section protected variables
-static portMUX_TYPE spinlock = portMUX_INITIALIZER_UNLOCKED;
-scope  const uint8_t *abase;
-scope  volatile uint32_t asize;
-static volatile uint32_t aidx;
-static volatile bool     cyclic;
+#define ONE_RING_SZ 256 // Sample ring size, a power of two
+#define ONE_DESC_NUM 2 // Default number of blocks in the ring
+#define ONE_BLK_SZ 32 // Default samples mixed per refill
+#define ONE_TASK_STACK 3072
+#define ONE_TASK_PRIO (configMAX_PRIORITIES-2) // Above the application's tasks
+#define US_PER_S 1000000ULL
 
-// Other global variables
+// Global variables
 static dac_oneshot_handle_t dac_handle;
 static gptimer_handle_t dac_timer;
 static volatile bool device_en;
-static volatile uint32_t volume;
-static volatile uint8_t bias; // to prevent popping at end when vol low.
+static bool active; // last sample came from the ring
+
+// Sample ring. Blocks of buf_size samples are mixed in by the refill
+// task and one sample per interrupt is output, without a lock (see
+// ring.h).
+static uint8_t ring_buf[ONE_RING_SZ];
+static ring_t ring;
+static uint32_t desc_num = ONE_DESC_NUM; // Blocks the ring may hold
+static uint32_t buf_size = ONE_BLK_SZ; // Samples per block, a power of two
+static volatile bool playing; // Last refill came from an active source
+static uint32_t idle_cnt; // Samples since the refill was polled when idle
+
+// Refill task, woken by the timer ISR
+static TaskHandle_t refill;
+static SemaphoreHandle_t refill_mutex; // Held while the ring is filled
+static StaticSemaphore_t refill_mutex_buf;
+
+static uint32_t rate; // Sample rate in Hz
+
+// Statistics updated by the refill task. Time is only read when a block
+// is mixed, not for each sample.
+static uint32_t period_us; // Time between samples
+static int64_t last_us; // Time of the previous refill, zero if none
+static volatile uint32_t fills, late, underruns, fill_max_us;
+
+
+// Mix blocks of samples into the ring until it is full or nothing is
+// playing. The mixer's lock and per-call overhead are paid once per
+// block rather than once per sample, and mixing runs in a task rather
+// than in the timer ISR. A refill is late if it comes more than 1.5
+// block times after the last.
+static void ring_refill(void)
+{
+	uint8_t *p;
+	bool woken = false;
+	// Blocks do not straddle the end of the ring since buf_size is a
+	// power of two no larger than the ring.
+	while (ring_count(&ring) + buf_size <= desc_num*buf_size &&
+		ring_write_ptr(&ring, &p) >= buf_size) {
+		int64_t now = esp_timer_get_time();
+		uint32_t blk_us = buf_size*period_us;
+		if (last_us && now - last_us > blk_us + blk_us/2) late++;
+		last_us = now;
+		fills++;
+		playing = sound_mix_fill(p, buf_size, &woken, false) != 0;
+		uint32_t dt = esp_timer_get_time() - now;
+		if (dt > fill_max_us) fill_max_us = dt;
+		if (!playing) break;
+		ring_write_commit(&ring, buf_size); // publish the block
+	}
+	if (woken) taskYIELD();
+}
 
+// Refill task. Waits for the timer ISR to report space in the ring.
+static void refill_task(void *arg)
+{
+	for (;;) {
+		ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+		xSemaphoreTake(refill_mutex, portMAX_DELAY);
+		ring_refill();
+		xSemaphoreGive(refill_mutex);
+	}
+}
 
-// DAC timer ISR callback
+// DAC timer ISR callback. Outputs one sample and wakes the refill task
+// when a block of space opens up in the ring, or once per block time
+// when nothing is playing so that a new sound is picked up.
 static bool IRAM_ATTR dac_timer_isr(gptimer_handle_t timer, const gptimer_alarm_event_data_t *edata, void *user_ctx)
 {
-	// TODO: why does critical section cause abort?
-	// portENTER_CRITICAL_ISR(&spinlock);
-	if (aidx < asize) {
-		uint32_t idx = aidx;
-		aidx =  cyclic ? (aidx + 1) % asize : aidx + 1;
-		// portEXIT_CRITICAL_ISR(&spinlock);
-		dac_oneshot_output_voltage(dac_handle, abase[idx]*volume/PERCENT + bias);
-	} else if (aidx == asize) {
-		aidx++;
-		// portEXIT_CRITICAL_ISR(&spinlock);
-		dac_oneshot_output_voltage(dac_handle, SILENCE);
+	BaseType_t hpw = pdFALSE;
+
+	const uint8_t *p;
+	if (ring_read_ptr(&ring, &p)) {
+		active = true;
+		dac_oneshot_output_voltage(dac_handle, *p);
+		ring_read_commit(&ring, 1); // release the sample
+		if (ring_count(&ring) == (desc_num-1)*buf_size)
+			vTaskNotifyGiveFromISR(refill, &hpw);
+	} else {
+		if (playing) underruns++; // refill did not keep up
+		if (active) {
+			active = false;
+			dac_oneshot_output_voltage(dac_handle, SILENCE);
+		}
+		if (!playing && ++idle_cnt >= buf_size) {
+			idle_cnt = 0;
+			vTaskNotifyGiveFromISR(refill, &hpw); // poll
+		}
 	}
-	return false; // no high priority task awoken
+	return hpw == pdTRUE; // true if high priority task awoken
 }
 
 // Initialize the sound driver. Must be called before using sound.
-// May be called again to change sample rate.
+// May be called again to change sample rate. The volume is set to the
+// default by the first call only.
 // sample_hz: sample rate in Hz to playback audio.
 // Return zero if successful, or non-zero otherwise.
 int32_t sound_init(uint32_t sample_hz)
 {
-	sound_set_volume(SOUND_VOLUME_DEFAULT);
+	if (sample_hz == 0) return 1;
+	if (ring.buf == NULL) ring_init(&ring, ring_buf, sizeof(ring_buf));
+	rate = sample_hz;
+	period_us = GPTIMER_RESOLUTION_HZ/sample_hz;
+	// Samples already in the ring play before a refill
+	sound_mix_init(sample_hz, (desc_num-1)*buf_size*US_PER_S/sample_hz);
+	sound_stats_reset();
 
 	// if the first time called, configure pins
 	if (dac_handle == NULL) {
@@ -98,6 +167,17 @@ int32_t sound_init(uint32_t sample_hz)
 		ESP_ERROR_CHECK(dac_oneshot_new_channel(&one_cfg, &dac_handle));
 	}
 
+	// if the first time called, create the refill task
+	if (refill == NULL) {
+		refill_mutex = xSemaphoreCreateMutexStatic(&refill_mutex_buf);
+		if (xTaskCreate(refill_task, "sound_one", ONE_TASK_STACK, NULL,
+			ONE_TASK_PRIO, &refill) != pdPASS) {
+			ESP_LOGE(TAG, "could not create refill task");
+			refill = NULL;
+			return 1;
+		}
+	}
+
 	// if the first time called, create and configure timer
 	if (dac_timer == NULL) {
 		// TODO: how to setup timer interrupt on CPU 1
@@ -155,60 +235,58 @@ int32_t sound_deinit(void)
 	return 0;
 }
 
-// Start playing the sound immediately. Play the audio buffer once.
-// audio: a pointer to an array of unsigned audio data.
-// size: the size of the array in bytes.
-// wait: if true, block until done playing, otherwise return straight away.
-void sound_start(const void *audio, uint32_t size, bool wait)
-{
-	portENTER_CRITICAL(&spinlock);
-	abase = audio;
-	asize = size;
-	aidx = 0;
-	cyclic = false;
-	portEXIT_CRITICAL(&spinlock);
-	while (wait && aidx < asize)
-		vTaskDelay(pdMS_TO_TICKS(POLL_DELAY));
-}
-
-// Cyclically play samples from audio buffer until sound_stop() is called.
-// audio: a pointer to an array of unsigned audio data.
-// size: the size of the array in bytes.
-void sound_cyclic(const void *audio, uint32_t size)
-{
-	portENTER_CRITICAL(&spinlock);
-	abase = audio;
-	asize = size;
-	aidx = 0;
-	cyclic = true;
-	portEXIT_CRITICAL(&spinlock);
-}
-
-// Return true if sound playing, otherwise return false.
-bool sound_busy(void)
+// Enable or disable the sound output device.
+// enable: if true, enable sound, otherwise disable.
+void sound_device(bool enable)
 {
-	return aidx < asize;
+	gpio_set_level(SOUND_EN, device_en = enable);
 }
 
-// Stop playing the sound.
-void sound_stop(void)
+// Set the number and size of the blocks in the sample ring. Samples are
+// mixed a block at a time by the refill task and output one per timer
+// interrupt.
+// desc_num: number of blocks the ring may hold (SOUND_DESC_MIN to
+// SOUND_DESC_MAX).
+// buf_size: samples per block, a power of two (SOUND_BUF_MIN and up).
+// The ring holds at most ONE_RING_SZ samples.
+// Return zero if successful, or non-zero otherwise.
+int32_t sound_config(uint32_t desc, uint32_t size)
 {
-	portENTER_CRITICAL(&spinlock);
-	aidx = asize;
-	portEXIT_CRITICAL(&spinlock);
+	if (desc < SOUND_DESC_MIN || desc > SOUND_DESC_MAX ||
+		size < SOUND_BUF_MIN || (size & (size-1)) ||
+		desc*size > ONE_RING_SZ) return 1;
+	if (dac_timer != NULL) ESP_ERROR_CHECK(gptimer_stop(dac_timer));
+	if (refill_mutex != NULL) xSemaphoreTake(refill_mutex, portMAX_DELAY);
+	desc_num = desc;
+	buf_size = size;
+	ring_reset(&ring); // keep blocks aligned to the ring
+	playing = false;
+	idle_cnt = 0;
+	if (refill_mutex != NULL) xSemaphoreGive(refill_mutex);
+	if (dac_timer == NULL) return 0;
+	int32_t err = sound_init(rate); // update latency for the new ring
+	ESP_ERROR_CHECK(gptimer_start(dac_timer));
+	return err;
 }
 
-// Set the volume.
-// volume: 0-100% as an integer value.
-void sound_set_volume(uint32_t vol)
+// Get the driver statistics.
+// *stats: pointer to structure that receives the statistics.
+void sound_stats(sound_stats_t *stats)
 {
-	volume = vol;
-	bias = SILENCE - (SILENCE * vol / PERCENT);
+	stats->desc_num = desc_num;
+	stats->buf_size = buf_size;
+	stats->buf_us = buf_size*period_us;
+	stats->fills = fills;
+	stats->late = late;
+	stats->underruns = underruns;
+	stats->fill_max_us = fill_max_us;
+	sound_mix_stats(stats);
 }
 
-// Enable or disable the sound output device.
-// enable: if true, enable sound, otherwise disable.
-void sound_device(bool enable)
+// Clear the driver statistics.
+void sound_stats_reset(void)
 {
-	gpio_set_level(SOUND_EN, device_en = enable);
+	last_us = 0;
+	fills = late = underruns = fill_max_us = 0;
+	sound_mix_stats_reset();
 }
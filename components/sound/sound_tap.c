@@ -0,0 +1,151 @@
+// Visualization tap. The refill path keeps every tap_dec-th output sample
+// (after volume) in tap_buf; the functions here read it from a task so
+// that oscilloscope and spectrum displays need no driver internals.
+
+#include <math.h> // sinf, cosf, powf
+
+#include "sound.h"
+#include "sound_mix.h"
+
+#define TAP_MASK (SOUND_TAP_LEN-1)
+#define Q15 32767
+#define Q15_SHIFT 15
+#define SAMPLE_SHIFT 8 // 8-bit sample to Q15
+
+// Written by the refill path
+uint8_t sound_tap_buf[SOUND_TAP_LEN];
+volatile uint32_t sound_tap_idx;
+volatile uint32_t sound_tap_dec;
+
+// FFT tables, built on first use
+static int16_t twiddle_re[SOUND_FFT_LEN/2], twiddle_im[SOUND_FFT_LEN/2];
+static int16_t window[SOUND_FFT_LEN]; // Hann window
+static bool tables;
+
+// Band edges as FFT bin indices, built for edge_n bands when the number
+// of bands changes. Band b covers bins [edge[b], edge[b+1]).
+static uint8_t edge[SOUND_FFT_LEN/2+1];
+static uint32_t edge_n;
+
+
+// Set the decimation of the visualization tap.
+// dec: keep one of every dec samples, or zero to turn the tap off.
+void sound_tap_config(uint32_t dec)
+{
+	sound_tap_dec = dec;
+}
+
+// Copy the most recent output samples kept by the tap, oldest first.
+// buf: buffer that receives the samples.
+// n: number of samples to copy, at most SOUND_TAP_LEN.
+// Return the number of samples copied.
+uint32_t sound_tap(uint8_t *buf, uint32_t n)
+{
+	if (n > SOUND_TAP_LEN) n = SOUND_TAP_LEN;
+	uint32_t idx = sound_tap_idx - n;
+	for (uint32_t i = 0; i < n; i++)
+		buf[i] = sound_tap_buf[(idx+i) & TAP_MASK];
+	return n;
+}
+
+// Build the twiddle factor and window tables.
+static void fft_tables(void)
+{
+	for (uint32_t i = 0; i < SOUND_FFT_LEN/2; i++) {
+		float a = 2*M_PI*i/SOUND_FFT_LEN;
+		twiddle_re[i] = Q15*cosf(a);
+		twiddle_im[i] = -Q15*sinf(a);
+	}
+	for (uint32_t i = 0; i < SOUND_FFT_LEN; i++)
+		window[i] = Q15*(0.5f - 0.5f*cosf(2*M_PI*i/(SOUND_FFT_LEN-1)));
+	tables = true;
+}
+
+// Build the band edges for n bands spaced logarithmically in frequency,
+// skipping the DC bin. Each band has at least one bin.
+static void band_edges(uint32_t n)
+{
+	float ratio = powf(SOUND_FFT_LEN/2, 1.0f/n);
+	float e = 1.0f;
+
+	edge[0] = 1;
+	for (uint32_t b = 0; b < n; b++) {
+		e *= ratio;
+		uint32_t hi = (b == n-1) ? SOUND_FFT_LEN/2 : (uint32_t)(e + 0.5f);
+		if (hi <= edge[b]) hi = edge[b]+1;
+		edge[b+1] = hi;
+	}
+	edge_n = n;
+}
+
+// In-place radix-2 FFT in Q15. Each stage halves the values so the
+// result cannot overflow, giving the transform divided by SOUND_FFT_LEN.
+static void fft(int16_t *re, int16_t *im)
+{
+	// Bit reversed reordering
+	for (uint32_t i = 0, j = 0; i < SOUND_FFT_LEN; i++) {
+		if (i < j) {
+			int16_t t = re[i]; re[i] = re[j]; re[j] = t;
+			t = im[i]; im[i] = im[j]; im[j] = t;
+		}
+		uint32_t bit = SOUND_FFT_LEN >> 1;
+		for (; j & bit; bit >>= 1) j ^= bit;
+		j |= bit;
+	}
+	// Butterflies
+	for (uint32_t len = 2, tstep = SOUND_FFT_LEN/2; len <= SOUND_FFT_LEN; len <<= 1, tstep >>= 1) {
+		for (uint32_t i = 0; i < SOUND_FFT_LEN; i += len) {
+			for (uint32_t k = 0; k < len/2; k++) {
+				int32_t wr = twiddle_re[k*tstep], wi = twiddle_im[k*tstep];
+				uint32_t a = i+k, b = i+k+len/2;
+				int32_t tr = (re[b]*wr - im[b]*wi) >> Q15_SHIFT;
+				int32_t ti = (re[b]*wi + im[b]*wr) >> Q15_SHIFT;
+				re[b] = (re[a] - tr) >> 1;
+				im[b] = (im[a] - ti) >> 1;
+				re[a] = (re[a] + tr) >> 1;
+				im[a] = (im[a] + ti) >> 1;
+			}
+		}
+	}
+}
+
+// Approximate the magnitude of a complex value (alpha max plus beta min).
+static inline uint32_t magnitude(int32_t re, int32_t im)
+{
+	uint32_t a = (re < 0) ? -re : re;
+	uint32_t b = (im < 0) ? -im : im;
+	return (a > b) ? a + b*3/8 : b + a*3/8;
+}
+
+// Compute the spectrum of the most recent SOUND_FFT_LEN tap samples and
+// reduce it to bands spaced logarithmically in frequency.
+// bands: array that receives the magnitude of each band.
+// n: number of bands (1 to SOUND_FFT_LEN/2).
+// Return zero if successful, or non-zero otherwise.
+int32_t sound_tap_bands(uint16_t *bands, uint32_t n)
+{
+	int16_t re[SOUND_FFT_LEN], im[SOUND_FFT_LEN];
+	uint8_t s[SOUND_FFT_LEN];
+	if (n == 0 || n > SOUND_FFT_LEN/2 || sound_tap_dec == 0) return 1;
+	if (!tables) fft_tables();
+	if (n != edge_n) band_edges(n);
+
+	sound_tap(s, SOUND_FFT_LEN);
+	for (uint32_t i = 0; i < SOUND_FFT_LEN; i++) {
+		int32_t x = ((int32_t)s[i] - (int32_t)SILENCE) << SAMPLE_SHIFT;
+		re[i] = (x * window[i]) >> Q15_SHIFT;
+		im[i] = 0;
+	}
+	fft(re, im);
+
+	// Largest magnitude in each band
+	for (uint32_t b = 0; b < n; b++) {
+		uint32_t m = 0;
+		for (uint32_t k = edge[b]; k < edge[b+1] && k < SOUND_FFT_LEN/2; k++) {
+			uint32_t v = magnitude(re[k], im[k]);
+			if (v > m) m = v;
+		}
+		bands[b] = m;
+	}
+	return 0;
+}
@@ -0,0 +1,24 @@
+#ifndef RTC_IO_H_
+#define RTC_IO_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Host stand-in for the RTC GPIO driver. Pull settings are recorded per
+// pin so they can be inspected, see stub/regs.c.
+
+typedef int32_t esp_err_t;
+
+#define HOST_RTC_PULLUP   (1U << 0)
+#define HOST_RTC_PULLDOWN (1U << 1)
+
+extern uint8_t host_rtc_pulls[64]; // HOST_RTC_* bits per pin
+
+bool rtc_gpio_is_valid_gpio(int32_t pin);
+esp_err_t rtc_gpio_deinit(int32_t pin);
+esp_err_t rtc_gpio_pullup_en(int32_t pin);
+esp_err_t rtc_gpio_pullup_dis(int32_t pin);
+esp_err_t rtc_gpio_pulldown_en(int32_t pin);
+esp_err_t rtc_gpio_pulldown_dis(int32_t pin);
+
+#endif // RTC_IO_H_
@@ -0,0 +1,8 @@
+#ifndef ESP_ATTR_H_
+#define ESP_ATTR_H_
+
+// Placement attributes have no meaning on the host.
+#define IRAM_ATTR
+#define DRAM_ATTR
+
+#endif // ESP_ATTR_H_
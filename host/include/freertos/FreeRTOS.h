@@ -0,0 +1,34 @@
+#ifndef FREERTOS_H_
+#define FREERTOS_H_
+
+// Host stand-in for the parts of FreeRTOS used by the components.
+// Critical sections map to one recursive mutex shared by all spinlocks,
+// which also serializes the "ISR" refill path with the task API.
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+typedef uint32_t TickType_t;
+
+#define pdFALSE 0
+#define pdTRUE  1
+#define pdPASS  pdTRUE
+#define portMAX_DELAY ((TickType_t)0xffffffffUL)
+#define portTICK_PERIOD_MS 1
+#define pdMS_TO_TICKS(ms) ((TickType_t)(ms))
+
+typedef int portMUX_TYPE;
+#define portMUX_INITIALIZER_UNLOCKED 0
+
+void host_critical_enter(portMUX_TYPE *mux);
+void host_critical_exit(portMUX_TYPE *mux);
+
+#define portENTER_CRITICAL(mux)     host_critical_enter(mux)
+#define portEXIT_CRITICAL(mux)      host_critical_exit(mux)
+#define portENTER_CRITICAL_ISR(mux) host_critical_enter(mux)
+#define portEXIT_CRITICAL_ISR(mux)  host_critical_exit(mux)
+
+#endif // FREERTOS_H_
@@ -0,0 +1,22 @@
+#ifndef SEMPHR_H_
+#define SEMPHR_H_
+
+#include <pthread.h>
+
+#include "freertos/FreeRTOS.h"
+
+// Binary semaphore built on a pthread mutex and condition variable.
+typedef struct {
+	pthread_mutex_t mutex;
+	pthread_cond_t cond;
+	bool given;
+} StaticSemaphore_t;
+typedef StaticSemaphore_t *SemaphoreHandle_t;
+
+SemaphoreHandle_t xSemaphoreCreateBinaryStatic(StaticSemaphore_t *buf);
+BaseType_t xSemaphoreTake(SemaphoreHandle_t sem, TickType_t ticks);
+BaseType_t xSemaphoreGive(SemaphoreHandle_t sem);
+BaseType_t xSemaphoreGiveFromISR(SemaphoreHandle_t sem, BaseType_t *woken);
+void vSemaphoreDelete(SemaphoreHandle_t sem);
+
+#endif // SEMPHR_H_
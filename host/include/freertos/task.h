@@ -0,0 +1,24 @@
+#ifndef TASK_H_
+#define TASK_H_
+
+#include "freertos/FreeRTOS.h"
+
+// Tasks run as threads. Core affinity and priority are ignored.
+typedef struct host_task *TaskHandle_t;
+typedef void (*TaskFunction_t)(void *arg);
+
+// Sleep the calling thread for the given number of ticks (1 ms each).
+void vTaskDelay(TickType_t ticks);
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t fn, const char *name,
+	uint32_t stack, void *arg, UBaseType_t priority, TaskHandle_t *task,
+	BaseType_t core);
+
+// Task notifications used as a counting semaphore.
+uint32_t ulTaskNotifyTake(BaseType_t clear, TickType_t ticks);
+BaseType_t xTaskNotifyGive(TaskHandle_t task);
+void vTaskNotifyGiveFromISR(TaskHandle_t task, BaseType_t *woken);
+
+void taskYIELD(void);
+
+#endif // TASK_H_
@@ -0,0 +1,30 @@
+#ifndef REG_BASE_H_
+#define REG_BASE_H_
+
+#include <stdint.h>
+
+// The GPIO and IO_MUX register blocks are backed by memory on the host,
+// so register level code (pin.c) runs unchanged and its writes can be
+// inspected. See stub/regs.c.
+
+#define HOST_GPIO_REGS 0x180 // 32-bit registers in the GPIO block
+#define HOST_IO_MUX_REGS 0x40 // 32-bit registers in the IO_MUX block
+
+extern volatile uint32_t host_gpio_regs[HOST_GPIO_REGS];
+extern volatile uint32_t host_io_mux_regs[HOST_IO_MUX_REGS];
+
+#define DR_REG_GPIO_BASE ((uintptr_t)host_gpio_regs)
+#define DR_REG_IO_MUX_BASE ((uintptr_t)host_io_mux_regs)
+
+// Clear all registers, as after a chip reset.
+void host_regs_reset(void);
+
+// Do what the hardware does on a write to a W1TS or W1TC register: set
+// or clear the written bits in the OUT and ENABLE registers, then clear
+// the W1TS and W1TC registers. Call after the code under test writes.
+void host_regs_latch(void);
+
+// Set the value of the input registers, one pin per bit.
+void host_regs_set_in(uint64_t in);
+
+#endif // REG_BASE_H_
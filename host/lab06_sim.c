@@ -0,0 +1,115 @@
+// Headless run of the lab06 game logic on the host. The game is fed a
+// scripted input log through the input layer, as a replay: the cursor
+// sweeps the screen and a button is pressed at a fixed rate. Drawing and
+// sound are stubbed out, so the times are those of the game alone.
+// Reports the simulated ticks per second and the distribution of the
+// time per tick, for the simulation and the render pass.
+// Usage:
+//   lab06_sim [ticks] [seed]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <time.h>
+
+#include "hw.h"
+#include "cursor.h"
+#include "input.h"
+#include "gameControl.h"
+#include "config.h"
+
+#define TICKS_DEFAULT INPUT_LOG_LEN
+#define SEED_DEFAULT 1
+#define PRESS_EVERY 8 // Ticks between button presses
+#define SWEEP_TICKS 200 // Ticks per cursor sweep cycle
+#define Q15_ONE 32767
+#define NS_PER_S 1000000000LL
+#define PER_MS ((uint32_t)(CONFIG_GAME_TIMER_PERIOD*1000))
+
+static input_frame_t script[INPUT_LOG_LEN];
+static int64_t t_tick[INPUT_LOG_LEN], t_draw[INPUT_LOG_LEN];
+
+// Return the time in nanoseconds.
+static int64_t now_ns(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec*NS_PER_S + ts.tv_nsec;
+}
+
+// Make the input script: the joystick goes around in an ellipse, so the
+// cursor covers the screen, and button A is pressed every PRESS_EVERY
+// ticks (bit 0 of a frame is the lowest button pin of the mask).
+static void script_make(uint32_t n)
+{
+	for (uint32_t t = 0; t < n; t++) {
+		float a = 2.0f*(float)M_PI*(t % SWEEP_TICKS)/SWEEP_TICKS;
+		script[t].x = (int16_t)(Q15_ONE*cosf(a));
+		script[t].y = (int16_t)(Q15_ONE*sinf(2.0f*a)/2);
+		script[t].press = (t % PRESS_EVERY == 0) ? 1 : 0;
+		script[t].down = 0;
+	}
+}
+
+static int cmp_i64(const void *a, const void *b)
+{
+	int64_t x = *(const int64_t *)a, y = *(const int64_t *)b;
+	return (x > y) - (x < y);
+}
+
+// Print the distribution of n times in ns (sorts them).
+static void print_dist(const char *name, int64_t *t, uint32_t n)
+{
+	int64_t sum = 0;
+
+	qsort(t, n, sizeof(t[0]), cmp_i64);
+	for (uint32_t i = 0; i < n; i++) sum += t[i];
+	printf("%-6s %10.0f %10lld %10lld %10lld %10lld %10lld\n", name,
+		(double)sum/n, (long long)t[0], (long long)t[n/2],
+		(long long)t[n*90/100], (long long)t[n*99/100], (long long)t[n-1]);
+}
+
+int main(int argc, char *argv[])
+{
+	uint32_t ticks = (argc > 1) ? strtoul(argv[1], NULL, 0) : TICKS_DEFAULT;
+	uint32_t seed = (argc > 2) ? strtoul(argv[2], NULL, 0) : SEED_DEFAULT;
+	uint32_t n = 0;
+	int64_t t0, t1, t2, total = 0;
+	float dx, dy;
+
+	if (ticks == 0 || ticks > INPUT_LOG_LEN) {
+		fprintf(stderr, "usage: %s [ticks (1-%u)] [seed]\n", argv[0], INPUT_LOG_LEN);
+		return EXIT_FAILURE;
+	}
+	script_make(ticks);
+	input_init(HW_BTN_MASK);
+	cursor_init(PER_MS);
+	input_replay(script, ticks);
+
+	// Same start as game_start() in lab06
+	cursor_set_pos(LCD_W/2, LCD_H/2);
+	gameControl_init(seed);
+
+	while (input_tick()) {
+		t0 = now_ns();
+		gameControl_tick();
+		input_get_joy(&dx, &dy);
+		cursor_move(dx, dy);
+		t1 = now_ns();
+		gameControl_draw();
+		t2 = now_ns();
+		t_tick[n] = t1 - t0;
+		t_draw[n] = t2 - t1;
+		total += t2 - t0;
+		n++;
+	}
+
+	printf("%u ticks, seed %u: %.0f ticks/s (%.0fx real time)\n", n, seed,
+		(double)n*NS_PER_S/total,
+		(double)n*NS_PER_S/total*CONFIG_GAME_TIMER_PERIOD);
+	printf("%-6s %10s %10s %10s %10s %10s %10s\n", "ns",
+		"mean", "min", "p50", "p90", "p99", "max");
+	print_dist("tick", t_tick, n);
+	print_dist("draw", t_draw, n);
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,72 @@
+// Benchmark of the lab06 missile pool batch functions on the host.
+// Each pool size runs the same workload: the free missiles are taken
+// from the pool and launched each tick, and one in eight launches is a
+// player missile to a random point so that explosions keep the
+// collision check busy.
+// Usage:
+//   missile_bench [ticks]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "missile.h"
+
+#define TICKS_DEFAULT 1000
+#define PLAYER_EVERY 8 // One player missile per this many missiles
+#define NS_PER_S 1000000000LL
+
+static rng_t rng;
+
+// Return the time in nanoseconds.
+static int64_t now_ns(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec*NS_PER_S + ts.tv_nsec;
+}
+
+// Launch all the free missiles of the pool.
+static void relaunch(void)
+{
+	static uint32_t launched;
+	missile_t m;
+
+	while (missile_alloc(&m)) {
+		if (launched++ % PLAYER_EVERY == 0)
+			missile_init_player(&m, rng_below(&rng, LCD_W), rng_below(&rng, LCD_H));
+		else
+			missile_init_enemy(&m);
+	}
+}
+
+int main(int argc, char *argv[])
+{
+	static const uint32_t sizes[] = {12, 100, 1000, 10000};
+	uint32_t ticks = (argc > 1) ? strtoul(argv[1], NULL, 0) : TICKS_DEFAULT;
+
+	if (ticks == 0) {
+		fprintf(stderr, "usage: %s [ticks]\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+	printf("%8s %12s %12s %10s\n", "missiles", "ns/tick", "ns/missile", "detonated");
+	for (uint32_t s = 0; s < sizeof(sizes)/sizeof(sizes[0]); s++) {
+		uint32_t n = sizes[s];
+		uint64_t det = 0;
+		if (n > MISSILE_POOL_MAX) break;
+		rng_seed(&rng, 1);
+		missiles_init(n, &rng);
+		relaunch();
+
+		int64_t t0 = now_ns();
+		for (uint32_t t = 0; t < ticks; t++) {
+			relaunch();
+			missiles_tick();
+			det += missiles_collide();
+		}
+		int64_t dt = now_ns() - t0;
+		printf("%8u %12.0f %12.1f %10llu\n", n, (double)dt/ticks,
+			(double)dt/ticks/n, (unsigned long long)det);
+	}
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,188 @@
+// Tests of the pin driver on the host, against the register mock in
+// stub/regs.c. The mask functions must write each pin's bit to the
+// W1TS or W1TC registers, never the OUT or ENABLE registers, and
+// pin_config_mask() must leave a pin as pin_reset() and the single pin
+// functions, each enabled or disabled by its flag, do.
+// Usage:
+//   pin_test
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "soc/reg_base.h"
+#include "driver/rtc_io.h"
+#include "pin.h"
+
+// Word index of registers in the GPIO block, see pin.c
+#define OUT          (0x04/4)
+#define OUT_W1TS     (0x08/4)
+#define OUT_W1TC     (0x0C/4)
+#define OUT1         (0x10/4)
+#define OUT1_W1TS    (0x14/4)
+#define OUT1_W1TC    (0x18/4)
+#define ENABLE       (0x20/4)
+#define ENABLE_W1TS  (0x24/4)
+#define ENABLE_W1TC  (0x28/4)
+#define ENABLE1      (0x2C/4)
+#define ENABLE1_W1TS (0x30/4)
+#define ENABLE1_W1TC (0x34/4)
+#define PIN0         (0x88/4)
+
+// Word index of IO_MUX registers, see PIN_MUX_REG_OFFSET in pin.c
+#define MUX_PIN5  (0x6c/4)
+#define MUX_PIN14 (0x30/4)
+
+// IO_MUX register fields
+#define FUN_WPD (1U << 7)
+#define FUN_WPU (1U << 8)
+#define FUN_IE  (1U << 9)
+#define MUX_GPIO ((2U << 12) | (2U << 10)) // MCU_SEL=2, FUN_DRV=2
+#define PAD_DRIVER (1U << 2)
+
+#define BIT(n) (1LLU << (n))
+#define CHECK(c) check((c), #c, __LINE__)
+
+static uint32_t failed;
+
+// Count and report a failed check.
+static void check(int ok, const char *what, int line)
+{
+	if (ok) return;
+	failed++;
+	fprintf(stderr, "pin_test.c:%d: check failed: %s\n", line, what);
+}
+
+// Outputs are set and cleared only through W1TS and W1TC.
+static void test_set_clear(void)
+{
+	host_regs_reset();
+	CHECK(pin_set_mask(BIT(3) | BIT(31) | BIT(32) | BIT(39)) == 0);
+	CHECK(host_gpio_regs[OUT_W1TS] == (1U << 3 | 1U << 31));
+	CHECK(host_gpio_regs[OUT1_W1TS] == (1U << 0 | 1U << 7));
+	CHECK(host_gpio_regs[OUT_W1TC] == 0 && host_gpio_regs[OUT1_W1TC] == 0);
+	CHECK(host_gpio_regs[OUT] == 0 && host_gpio_regs[OUT1] == 0);
+	host_regs_latch();
+	CHECK(pin_get_out_reg() == (BIT(3) | BIT(31) | BIT(32) | BIT(39)));
+
+	// Only the pins in the mask change
+	CHECK(pin_clear_mask(BIT(31) | BIT(32)) == 0);
+	CHECK(host_gpio_regs[OUT_W1TC] == 1U << 31);
+	CHECK(host_gpio_regs[OUT1_W1TC] == 1U << 0);
+	CHECK(host_gpio_regs[OUT_W1TS] == 0 && host_gpio_regs[OUT1_W1TS] == 0);
+	host_regs_latch();
+	CHECK(pin_get_out_reg() == (BIT(3) | BIT(39)));
+
+	// A half that is not in the mask is not written
+	CHECK(pin_set_mask(BIT(34)) == 0);
+	CHECK(host_gpio_regs[OUT_W1TS] == 0 && host_gpio_regs[OUT1_W1TS] == 1U << 2);
+	host_regs_latch();
+
+	host_regs_set_in(BIT(0) | BIT(35));
+	CHECK(pin_get_in_reg() == (BIT(0) | BIT(35)));
+}
+
+// Outputs: enabled with one W1TS write per half, level cleared first,
+// no pull unless asked for.
+static void test_config_output(void)
+{
+	host_regs_reset();
+	CHECK(pin_config_mask(BIT(2) | BIT(5) | BIT(33), PIN_OUTPUT | PIN_ODRAIN) == 0);
+	CHECK(host_gpio_regs[ENABLE_W1TS] == (1U << 2 | 1U << 5));
+	CHECK(host_gpio_regs[ENABLE1_W1TS] == 1U << 1);
+	CHECK(host_gpio_regs[ENABLE_W1TC] == 0 && host_gpio_regs[ENABLE1_W1TC] == 0);
+	CHECK(host_gpio_regs[OUT_W1TC] == (1U << 2 | 1U << 5));
+	CHECK(host_gpio_regs[OUT1_W1TC] == 1U << 1);
+	CHECK(host_gpio_regs[OUT_W1TS] == 0 && host_gpio_regs[OUT1_W1TS] == 0);
+	CHECK(host_io_mux_regs[MUX_PIN5] == MUX_GPIO);
+	CHECK(host_gpio_regs[PIN0 + 5] == PAD_DRIVER);
+	CHECK(host_rtc_pulls[2] == 0); // RTC pin, pulls through the RTC driver
+	host_regs_latch();
+	CHECK(host_gpio_regs[ENABLE] == (1U << 2 | 1U << 5));
+	CHECK(host_gpio_regs[ENABLE1] == 1U << 1);
+}
+
+// Inputs: outputs disabled with W1TC, input enable and pull-up set.
+static void test_config_input(void)
+{
+	host_regs_reset();
+	host_gpio_regs[ENABLE] = 1U << 5 | 1U << 14 | 1U << 15;
+	CHECK(pin_config_mask(BIT(5) | BIT(14) | BIT(39), PIN_INPUT | PIN_PULLUP) == 0);
+	CHECK(host_gpio_regs[ENABLE_W1TC] == (1U << 5 | 1U << 14));
+	CHECK(host_gpio_regs[ENABLE1_W1TC] == 1U << 7);
+	CHECK(host_gpio_regs[ENABLE_W1TS] == 0 && host_gpio_regs[ENABLE1_W1TS] == 0);
+	CHECK(host_io_mux_regs[MUX_PIN5] == (MUX_GPIO | FUN_IE | FUN_WPU));
+	CHECK(host_io_mux_regs[MUX_PIN14] == (MUX_GPIO | FUN_IE | FUN_WPU));
+	CHECK(host_rtc_pulls[14] == HOST_RTC_PULLUP);
+	CHECK(host_rtc_pulls[39] == HOST_RTC_PULLUP);
+	CHECK(host_gpio_regs[PIN0 + 5] == 0);
+	host_regs_latch();
+	CHECK(host_gpio_regs[ENABLE] == 1U << 15); // Pin 15 not in the mask
+}
+
+// Take a copy of all registers and RTC pulls after the W1TS and W1TC
+// writes are latched.
+static void snapshot(uint32_t *gpio, uint32_t *mux, uint8_t *pulls)
+{
+	host_regs_latch();
+	memcpy(gpio, (const void *)host_gpio_regs, sizeof(host_gpio_regs));
+	memcpy(mux, (const void *)host_io_mux_regs, sizeof(host_io_mux_regs));
+	memcpy(pulls, host_rtc_pulls, sizeof(host_rtc_pulls));
+}
+
+// pin_config_mask() leaves the registers as pin_reset() and the single
+// pin functions do, each enabled if its flag is given and disabled if
+// not. A pull-up left on by pin_reset() is then turned off.
+static void test_config_same(void)
+{
+	static const struct {pin_num_t pin; uint32_t flags;} cases[] = {
+		{5, PIN_INPUT | PIN_PULLUP},
+		{14, PIN_INPUT | PIN_PULLUP}, // RTC pin
+		{18, PIN_OUTPUT},
+		{33, PIN_OUTPUT | PIN_ODRAIN},
+		{21, PIN_INPUT | PIN_PULLDOWN},
+		{27, PIN_INPUT | PIN_PULLDOWN}, // RTC pin
+	};
+	static uint32_t gpio[2][HOST_GPIO_REGS], mux[2][HOST_IO_MUX_REGS];
+	static uint8_t pulls[2][64];
+
+	for (uint32_t i = 0; i < sizeof(cases)/sizeof(cases[0]); i++) {
+		pin_num_t p = cases[i].pin;
+		uint32_t f = cases[i].flags;
+
+		host_regs_reset();
+		pin_reset(p);
+		pin_pullup(p, f & PIN_PULLUP);
+		pin_pulldown(p, f & PIN_PULLDOWN);
+		pin_input(p, f & PIN_INPUT);
+		pin_output(p, f & PIN_OUTPUT);
+		pin_odrain(p, f & PIN_ODRAIN);
+		snapshot(gpio[0], mux[0], pulls[0]);
+
+		host_regs_reset();
+		CHECK(pin_config_mask(BIT(p), f) == 0);
+		snapshot(gpio[1], mux[1], pulls[1]);
+
+		CHECK(memcmp(gpio[0], gpio[1], sizeof(gpio[0])) == 0);
+		CHECK(memcmp(mux[0], mux[1], sizeof(mux[0])) == 0);
+		CHECK(memcmp(pulls[0], pulls[1], sizeof(pulls[0])) == 0);
+	}
+}
+
+// Pins that do not exist are rejected.
+static void test_config_invalid(void)
+{
+	CHECK(pin_config_mask(BIT(28), PIN_INPUT) != 0);
+	CHECK(pin_config_mask(BIT(40), PIN_INPUT) != 0);
+}
+
+int main(void)
+{
+	test_set_clear();
+	test_config_output();
+	test_config_input();
+	test_config_same();
+	test_config_invalid();
+	printf("pin: %s\n", failed ? "FAILED" : "passed");
+	return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,216 @@
+// Tests of the single producer, single consumer ring on the host.
+// The unit checks cover the size check, an empty and a full ring and
+// data that wraps around the end of the buffer. The stress test runs a
+// producer and a consumer thread on a small ring and checks that a
+// numbered sequence arrives complete and in order.
+// Usage:
+//   ring_test [items]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <sched.h> // sched_yield
+
+#include "ring.h"
+
+#define ITEMS_DEFAULT 4000000 // Numbers sent by the stress test
+#define STRESS_SIZE 64 // Bytes in the stress test ring
+#define ITEM_SIZE sizeof(uint32_t)
+#define CHUNK_MAX 23 // Most bytes moved at once, not a divisor of the size
+
+#define CHECK(c) check((c), #c, __LINE__)
+
+static uint32_t failed;
+
+static ring_t ring;
+static uint8_t buf[STRESS_SIZE];
+static uint32_t items;
+static uint64_t received; // Bytes checked by the consumer
+static uint64_t bad_at = UINT64_MAX; // First byte out of order
+
+// Count and report a failed check.
+static void check(int ok, const char *what, int line)
+{
+	if (ok) return;
+	failed++;
+	fprintf(stderr, "ring_test.c:%d: check failed: %s\n", line, what);
+}
+
+// Return byte k of the stream of numbers 0, 1, 2, ... in little endian.
+static uint8_t stream_byte(uint64_t k)
+{
+	return (uint8_t)((k / ITEM_SIZE) >> (8 * (k % ITEM_SIZE)));
+}
+
+// A ring needs a buffer with a size that is a power of two.
+static void test_init(void)
+{
+	uint8_t b[8];
+
+	CHECK(ring_init(&ring, b, 8) == 0);
+	CHECK(ring_init(&ring, b, 1) == 0);
+	CHECK(ring_init(&ring, b, 0) != 0);
+	CHECK(ring_init(&ring, b, 6) != 0);
+	CHECK(ring_init(&ring, b, 7) != 0);
+	CHECK(ring_init(&ring, NULL, 8) != 0);
+}
+
+// Reads from an empty ring return nothing.
+static void test_empty(void)
+{
+	uint8_t b[8], out[4];
+	const uint8_t *p;
+
+	ring_init(&ring, b, sizeof(b));
+	CHECK(ring_count(&ring) == 0);
+	CHECK(ring_space(&ring) == sizeof(b));
+	CHECK(ring_read(&ring, out, sizeof(out)) == 0);
+	CHECK(ring_read_ptr(&ring, &p) == 0);
+
+	// Empty again after the data is read
+	CHECK(ring_write(&ring, (const uint8_t *)"ab", 2) == 2);
+	CHECK(ring_read(&ring, out, sizeof(out)) == 2);
+	CHECK(memcmp(out, "ab", 2) == 0);
+	CHECK(ring_count(&ring) == 0);
+	CHECK(ring_read(&ring, out, sizeof(out)) == 0);
+}
+
+// Writes to a full ring are cut short, and a full ring holds all of its
+// bytes (the free running indices need no unused slot).
+static void test_full(void)
+{
+	uint8_t b[8], out[8];
+	uint8_t *p;
+
+	ring_init(&ring, b, sizeof(b));
+	CHECK(ring_write(&ring, (const uint8_t *)"0123456789", 10) == 8);
+	CHECK(ring_count(&ring) == 8);
+	CHECK(ring_space(&ring) == 0);
+	CHECK(ring_write(&ring, (const uint8_t *)"x", 1) == 0);
+	CHECK(ring_write_ptr(&ring, &p) == 0);
+	CHECK(ring_read(&ring, out, sizeof(out)) == 8);
+	CHECK(memcmp(out, "01234567", 8) == 0);
+
+	ring_reset(&ring);
+	CHECK(ring_count(&ring) == 0);
+	CHECK(ring_space(&ring) == sizeof(b));
+}
+
+// Data that wraps around the end of the buffer is read back in order,
+// by copy and in place.
+static void test_wrap(void)
+{
+	uint8_t b[8], out[8];
+	const uint8_t *rp;
+	uint8_t *wp;
+
+	ring_init(&ring, b, sizeof(b));
+	CHECK(ring_write(&ring, (const uint8_t *)"abcdef", 6) == 6);
+	CHECK(ring_read(&ring, out, 5) == 5);
+	CHECK(ring_write(&ring, (const uint8_t *)"ghijk", 5) == 5); // Wraps
+	CHECK(ring_count(&ring) == 6);
+	CHECK(ring_read(&ring, out, sizeof(out)) == 6);
+	CHECK(memcmp(out, "fghijk", 6) == 0);
+
+	// In place, the space and data stop at the end of the buffer
+	CHECK(ring_write_ptr(&ring, &wp) == 5); // Indices at 3 of 8
+	CHECK(wp == b+3);
+	memcpy(wp, "lmnop", 5);
+	ring_write_commit(&ring, 5);
+	CHECK(ring_write_ptr(&ring, &wp) == 3);
+	CHECK(wp == b);
+	memcpy(wp, "qrs", 3);
+	ring_write_commit(&ring, 3);
+	CHECK(ring_read_ptr(&ring, &rp) == 5);
+	CHECK(rp == b+3 && memcmp(rp, "lmnop", 5) == 0);
+	ring_read_commit(&ring, 5);
+	CHECK(ring_read_ptr(&ring, &rp) == 3);
+	CHECK(rp == b && memcmp(rp, "qrs", 3) == 0);
+	ring_read_commit(&ring, 3);
+	CHECK(ring_count(&ring) == 0);
+
+	// The free running indices wrap around 2^32
+	atomic_store(&ring.head, UINT32_MAX - 2);
+	atomic_store(&ring.tail, UINT32_MAX - 2);
+	CHECK(ring_write(&ring, (const uint8_t *)"tuvwx", 5) == 5);
+	CHECK(ring_count(&ring) == 5);
+	CHECK(ring_space(&ring) == 3);
+	CHECK(ring_read(&ring, out, sizeof(out)) == 5);
+	CHECK(memcmp(out, "tuvwx", 5) == 0);
+}
+
+// Producer: write the stream in chunks of varying size.
+static void *producer(void *arg)
+{
+	uint64_t total = (uint64_t)items * ITEM_SIZE, k = 0;
+	uint8_t chunk[CHUNK_MAX];
+	uint32_t len = 1, n;
+
+	while (k < total) {
+		n = (total - k < len) ? (uint32_t)(total - k) : len;
+		for (uint32_t i = 0; i < n; i++) chunk[i] = stream_byte(k + i);
+		n = ring_write(&ring, chunk, n);
+		if (n == 0) sched_yield(); // Full, let the consumer run
+		k += n;
+		len = len % CHUNK_MAX + 1;
+	}
+	return NULL;
+}
+
+// Consumer: read the stream in place, in chunks of varying size, and
+// check each byte.
+static void *consumer(void *arg)
+{
+	uint64_t total = (uint64_t)items * ITEM_SIZE;
+	const uint8_t *p;
+	uint32_t len = CHUNK_MAX, n;
+
+	while (received < total) {
+		n = ring_read_ptr(&ring, &p);
+		if (n == 0) sched_yield(); // Empty, let the producer run
+		if (n > len) n = len;
+		for (uint32_t i = 0; i < n; i++)
+			if (p[i] != stream_byte(received + i) && bad_at == UINT64_MAX)
+				bad_at = received + i;
+		ring_read_commit(&ring, n);
+		received += n;
+		len = (len > 1) ? len - 1 : CHUNK_MAX;
+	}
+	return NULL;
+}
+
+// Send items numbers through a small ring between two threads.
+static void test_stress(void)
+{
+	pthread_t prod, cons;
+
+	ring_init(&ring, buf, sizeof(buf));
+	received = 0;
+	pthread_create(&cons, NULL, consumer, NULL);
+	pthread_create(&prod, NULL, producer, NULL);
+	pthread_join(prod, NULL);
+	pthread_join(cons, NULL);
+	CHECK(received == (uint64_t)items * ITEM_SIZE);
+	CHECK(ring_count(&ring) == 0);
+	CHECK(bad_at == UINT64_MAX);
+	if (bad_at != UINT64_MAX)
+		fprintf(stderr, "stream out of order at byte %llu\n", (unsigned long long)bad_at);
+}
+
+int main(int argc, char *argv[])
+{
+	items = (argc > 1) ? strtoul(argv[1], NULL, 0) : ITEMS_DEFAULT;
+	if (items == 0) {
+		fprintf(stderr, "usage: %s [items]\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+	test_init();
+	test_empty();
+	test_full();
+	test_wrap();
+	test_stress();
+	printf("%u items through a %u byte ring: %s\n", items, STRESS_SIZE,
+		failed ? "FAILED" : "passed");
+	return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,107 @@
+// Render the output of the sound pipeline to a WAV file on the host.
+// Usage:
+//   sound_render out.wav tone <sin|squ|tri|saw> <freq_hz> <ms> [vol] [rate]
+//   sound_render out.wav clip <file.raw> [vol] [rate] [clip_rate]
+//   sound_render out.wav music [vol] [rate]
+// A raw clip is 8-bit unsigned mono audio, like the c24k_8b arrays.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "sound.h"
+#include "sound_host.h"
+#include "tone.h"
+#include "music.h"
+
+#define RATE_DEFAULT 24000 // Hz
+#define VOL_DEFAULT MAX_VOL
+#define MS_PER_S 1000U
+
+// Scale: C major, one note per beat
+static const music_inst_t insts[] = {
+	{SQUARE_T, 5, 60, 160, 120},
+	{TRIANGLE_T, 2, 200, 96, 300},
+};
+static const music_event_t events[] = {
+	{0, 60, 3, 0}, {4, 62, 3, 0}, {4, 64, 3, 0}, {4, 65, 3, 0},
+	{4, 67, 3, 0}, {4, 69, 3, 0}, {4, 71, 3, 0}, {4, 72, 8, 1},
+	{0, 48, 8, 1},
+};
+static const music_song_t song = {
+	events, sizeof(events)/sizeof(events[0]),
+	insts, sizeof(insts)/sizeof(insts[0]),
+	120, false,
+};
+
+static int usage(const char *prog)
+{
+	fprintf(stderr,
+		"usage: %s out.wav tone <sin|squ|tri|saw> <freq_hz> <ms> [vol] [rate]\n"
+		"       %s out.wav clip <file.raw> [vol] [rate] [clip_rate]\n"
+		"       %s out.wav music [vol] [rate]\n", prog, prog, prog);
+	return EXIT_FAILURE;
+}
+
+// Return optional argument i as a number, or def if not present.
+static uint32_t arg_num(int argc, char *argv[], int i, uint32_t def)
+{
+	return (i < argc) ? strtoul(argv[i], NULL, 0) : def;
+}
+
+int main(int argc, char *argv[])
+{
+	static const char *tnames[] = {"sin", "squ", "tri", "saw"};
+	int32_t n = -1;
+
+	if (argc < 3) return usage(argv[0]);
+	const char *out = argv[1];
+	const char *mode = argv[2];
+
+	if (!strcmp(mode, "tone") && argc >= 6) {
+		tone_t t;
+		for (t = SINE_T; t < LAST_T; t++)
+			if (!strcmp(argv[3], tnames[t])) break;
+		if (t == LAST_T) return usage(argv[0]);
+		uint32_t rate = arg_num(argc, argv, 7, RATE_DEFAULT);
+		if (tone_init(rate)) return EXIT_FAILURE;
+		tone_set_volume(arg_num(argc, argv, 6, VOL_DEFAULT));
+		tone_start(t, strtoul(argv[4], NULL, 0));
+		n = sound_host_render(out, strtoul(argv[5], NULL, 0)*rate/MS_PER_S);
+		tone_deinit();
+	} else if (!strcmp(mode, "clip") && argc >= 4) {
+		FILE *fp = fopen(argv[3], "rb");
+		if (fp == NULL) {
+			perror(argv[3]);
+			return EXIT_FAILURE;
+		}
+		fseek(fp, 0, SEEK_END);
+		long size = ftell(fp);
+		rewind(fp);
+		uint8_t *clip = malloc(size > 0 ? size : 1);
+		if (clip == NULL || fread(clip, 1, size, fp) != (size_t)size) return EXIT_FAILURE;
+		fclose(fp);
+		if (sound_init(arg_num(argc, argv, 5, RATE_DEFAULT))) return EXIT_FAILURE;
+		sound_set_volume(arg_num(argc, argv, 4, VOL_DEFAULT));
+		sound_start_hz(clip, size, arg_num(argc, argv, 6, 0), false);
+		n = sound_host_render(out, 0);
+		sound_deinit();
+		free(clip);
+	} else if (!strcmp(mode, "music")) {
+		uint32_t rate = arg_num(argc, argv, 4, RATE_DEFAULT);
+		if (sound_init(rate) || music_init(rate)) return EXIT_FAILURE;
+		sound_set_volume(arg_num(argc, argv, 3, VOL_DEFAULT));
+		music_play(&song);
+		n = sound_host_render(out, 0);
+		sound_deinit();
+	} else {
+		return usage(argv[0]);
+	}
+
+	if (n < 0) {
+		fprintf(stderr, "error writing %s\n", out);
+		return EXIT_FAILURE;
+	}
+	printf("%s: %ld samples\n", out, (long)n);
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,159 @@
+// Regression tests of the sound pipeline on the host. A tone, a clip and
+// a music sequence are rendered to WAV files with sound_host_render(),
+// read back and compared with the sample count and checksum of a known
+// good render. A clip at the output rate and full volume must come out
+// unchanged. After an intended change to the mixer, tone or music
+// output, update the expected values from the printed ones.
+// Usage:
+//   sound_test
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "sound.h"
+#include "sound_host.h"
+#include "tone.h"
+#include "music.h"
+
+#define RATE 24000 // Hz
+#define WAV_PATH "sound_test.wav"
+#define WAV_HDR_SZ 44
+#define WAV_MAX (RATE*SOUND_HOST_MAX_SEC)
+#define TONE_MS 100
+#define MS_PER_S 1000U
+#define CLIP_LEN 1000
+#define CLIP_HZ 11025 // Clip rate for the resampled render
+#define SILENCE 0x80 // Output when nothing plays
+
+#define CHECK(c) check((c), #c, __LINE__)
+
+static uint32_t failed;
+static uint8_t wav[WAV_HDR_SZ + WAV_MAX];
+static uint8_t clip[CLIP_LEN];
+
+// Same song as sound_render: C major scale, then a chord
+static const music_inst_t insts[] = {
+	{SQUARE_T, 5, 60, 160, 120},
+	{TRIANGLE_T, 2, 200, 96, 300},
+};
+static const music_event_t events[] = {
+	{0, 60, 3, 0}, {4, 62, 3, 0}, {4, 64, 3, 0}, {4, 65, 3, 0},
+	{4, 67, 3, 0}, {4, 69, 3, 0}, {4, 71, 3, 0}, {4, 72, 8, 1},
+	{0, 48, 8, 1},
+};
+static const music_song_t song = {
+	events, sizeof(events)/sizeof(events[0]),
+	insts, sizeof(insts)/sizeof(insts[0]),
+	120, false,
+};
+
+// Count and report a failed check.
+static void check(int ok, const char *what, int line)
+{
+	if (ok) return;
+	failed++;
+	fprintf(stderr, "sound_test.c:%d: check failed: %s\n", line, what);
+}
+
+// Return the 32-bit FNV-1a hash of n bytes.
+static uint32_t fnv1a(const uint8_t *p, uint32_t n)
+{
+	uint32_t h = 2166136261U;
+	for (uint32_t i = 0; i < n; i++) h = (h ^ p[i]) * 16777619U;
+	return h;
+}
+
+// Return a little endian value of n bytes.
+static uint32_t get_le(const uint8_t *p, uint32_t n)
+{
+	uint32_t val = 0;
+	while (n--) val = (val << 8) | p[n];
+	return val;
+}
+
+// Render to the WAV file and read it back into wav.
+// samples: passed to sound_host_render().
+// Return the number of samples read, or zero on error.
+static uint32_t render(uint32_t samples)
+{
+	int32_t n = sound_host_render(WAV_PATH, samples);
+	CHECK(n > 0);
+	if (n <= 0) return 0;
+	FILE *fp = fopen(WAV_PATH, "rb");
+	if (fp == NULL) return 0;
+	size_t len = fread(wav, 1, sizeof(wav), fp);
+	fclose(fp);
+	remove(WAV_PATH);
+	CHECK(len == WAV_HDR_SZ + (size_t)n);
+	CHECK(memcmp(wav, "RIFF", 4) == 0 && memcmp(wav+8, "WAVEfmt ", 8) == 0);
+	CHECK(get_le(wav+22, 2) == 1 && get_le(wav+24, 4) == RATE); // mono
+	CHECK(get_le(wav+34, 2) == 8); // bits per sample
+	CHECK(memcmp(wav+36, "data", 4) == 0 && get_le(wav+40, 4) == (uint32_t)n);
+	return (len == WAV_HDR_SZ + (size_t)n) ? n : 0;
+}
+
+// Compare a render with its expected sample count and checksum.
+static void expect(const char *name, uint32_t n, uint32_t count, uint32_t sum)
+{
+	uint32_t h = fnv1a(wav+WAV_HDR_SZ, n);
+	printf("%-8s %6u samples, checksum 0x%08x\n", name, n, h);
+	CHECK(n == count);
+	CHECK(h == sum);
+}
+
+// A sine tone for a fixed time.
+static void test_tone(void)
+{
+	CHECK(tone_init(RATE) == 0);
+	tone_set_volume(MAX_VOL);
+	tone_start(SINE_T, 440);
+	uint32_t n = render(TONE_MS*RATE/MS_PER_S);
+	tone_stop();
+	tone_deinit();
+	expect("tone", n, TONE_MS*RATE/MS_PER_S, 0xdea7fe67);
+}
+
+// A clip at the output rate plays unchanged, then a resampled clip.
+static void test_clip(void)
+{
+	uint32_t n, same = 1;
+
+	for (uint32_t i = 0; i < CLIP_LEN; i++) clip[i] = (i * 7) & 0xFF;
+	CHECK(sound_init(RATE) == 0);
+	sound_set_volume(MAX_VOL);
+	sound_start(clip, CLIP_LEN, false);
+	n = render(0);
+	CHECK(n >= CLIP_LEN);
+	if (n >= CLIP_LEN) same = memcmp(wav+WAV_HDR_SZ, clip, CLIP_LEN) == 0;
+	CHECK(same);
+	for (uint32_t i = CLIP_LEN; i < n; i++)
+		if (wav[WAV_HDR_SZ+i] != SILENCE) same = 0;
+	CHECK(same); // silence after the clip
+
+	sound_start_hz(clip, CLIP_LEN, CLIP_HZ, false);
+	n = render(0);
+	sound_deinit();
+	expect("clip", n, 3328, 0x59717305);
+}
+
+// A music sequence of two instruments, until it ends.
+static void test_music(void)
+{
+	CHECK(sound_init(RATE) == 0);
+	CHECK(music_init(RATE) == 0);
+	sound_set_volume(MAX_VOL);
+	CHECK(music_play(&song) == 0);
+	uint32_t n = render(0);
+	sound_deinit();
+	expect("music", n, 111744, 0x9fece64e);
+}
+
+int main(void)
+{
+	test_tone();
+	test_clip();
+	test_music();
+	printf("sound: %s\n", failed ? "FAILED" : "passed");
+	return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,9 @@
+// Host stand-in for the buttons component. No button is ever down; the
+// game is driven through a replayed input log instead.
+
+#include "buttons.h"
+
+int32_t buttons_init(uint64_t mask) { return 0; }
+int32_t buttons_deinit(void) { return 0; }
+uint64_t buttons_pressed(void) { return 0; }
+uint64_t buttons_state(void) { return 0; }
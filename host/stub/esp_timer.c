@@ -0,0 +1,19 @@
+// Host stand-in for the ESP timer service.
+
+#include <time.h>
+
+#include "esp_timer.h"
+
+#define US_PER_S 1000000LL
+#define NS_PER_US 1000L
+
+// Return the time in microseconds since the program started.
+int64_t esp_timer_get_time(void)
+{
+	static int64_t base;
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	int64_t now = ts.tv_sec*US_PER_S + ts.tv_nsec/NS_PER_US;
+	if (base == 0) base = now - 1; // never zero, like the ESP timer after boot
+	return now - base;
+}
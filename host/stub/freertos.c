@@ -0,0 +1,177 @@
+// Host stand-in for the parts of FreeRTOS used by the components.
+
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+
+#define NS_PER_MS 1000000L
+#define NS_PER_S 1000000000L
+
+struct host_task {
+	pthread_t thread;
+	pthread_mutex_t mutex;
+	pthread_cond_t cond;
+	uint32_t notify;
+	TaskFunction_t fn;
+	void *arg;
+};
+
+static pthread_mutex_t critical;
+static pthread_once_t critical_once = PTHREAD_ONCE_INIT;
+
+static void critical_init(void)
+{
+	pthread_mutexattr_t attr;
+	pthread_mutexattr_init(&attr);
+	pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+	pthread_mutex_init(&critical, &attr);
+	pthread_mutexattr_destroy(&attr);
+}
+
+void host_critical_enter(portMUX_TYPE *mux)
+{
+	pthread_once(&critical_once, critical_init);
+	pthread_mutex_lock(&critical);
+}
+
+void host_critical_exit(portMUX_TYPE *mux)
+{
+	pthread_mutex_unlock(&critical);
+}
+
+void vTaskDelay(TickType_t ticks)
+{
+	struct timespec ts = {
+		.tv_sec = ticks / 1000,
+		.tv_nsec = (ticks % 1000) * NS_PER_MS,
+	};
+	while (nanosleep(&ts, &ts) && errno == EINTR) ;
+}
+
+SemaphoreHandle_t xSemaphoreCreateBinaryStatic(StaticSemaphore_t *buf)
+{
+	pthread_mutex_init(&buf->mutex, NULL);
+	pthread_cond_init(&buf->cond, NULL);
+	buf->given = false;
+	return buf;
+}
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t sem, TickType_t ticks)
+{
+	struct timespec ts;
+	int err = 0;
+	clock_gettime(CLOCK_REALTIME, &ts);
+	ts.tv_sec += ticks / 1000;
+	ts.tv_nsec += (ticks % 1000) * NS_PER_MS;
+	if (ts.tv_nsec >= NS_PER_S) {
+		ts.tv_sec++;
+		ts.tv_nsec -= NS_PER_S;
+	}
+	pthread_mutex_lock(&sem->mutex);
+	while (!sem->given && err == 0) {
+		if (ticks == portMAX_DELAY) err = pthread_cond_wait(&sem->cond, &sem->mutex);
+		else err = pthread_cond_timedwait(&sem->cond, &sem->mutex, &ts);
+	}
+	BaseType_t ret = sem->given ? pdTRUE : pdFALSE;
+	sem->given = false;
+	pthread_mutex_unlock(&sem->mutex);
+	return ret;
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t sem)
+{
+	pthread_mutex_lock(&sem->mutex);
+	BaseType_t ret = sem->given ? pdFALSE : pdTRUE;
+	sem->given = true;
+	pthread_cond_signal(&sem->cond);
+	pthread_mutex_unlock(&sem->mutex);
+	return ret;
+}
+
+BaseType_t xSemaphoreGiveFromISR(SemaphoreHandle_t sem, BaseType_t *woken)
+{
+	BaseType_t ret = xSemaphoreGive(sem);
+	if (woken && ret == pdTRUE) *woken = pdTRUE;
+	return ret;
+}
+
+void vSemaphoreDelete(SemaphoreHandle_t sem)
+{
+	pthread_cond_destroy(&sem->cond);
+	pthread_mutex_destroy(&sem->mutex);
+}
+
+static __thread TaskHandle_t self; // Task of the calling thread
+
+static void *task_start(void *arg)
+{
+	self = arg;
+	self->fn(self->arg);
+	return NULL;
+}
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t fn, const char *name,
+	uint32_t stack, void *arg, UBaseType_t priority, TaskHandle_t *task,
+	BaseType_t core)
+{
+	TaskHandle_t t = calloc(1, sizeof(*t));
+	if (t == NULL) return pdFALSE;
+	pthread_mutex_init(&t->mutex, NULL);
+	pthread_cond_init(&t->cond, NULL);
+	t->fn = fn;
+	t->arg = arg;
+	if (task) *task = t;
+	if (pthread_create(&t->thread, NULL, task_start, t)) return pdFALSE;
+	pthread_detach(t->thread);
+	return pdPASS;
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t clear, TickType_t ticks)
+{
+	TaskHandle_t t = self;
+	struct timespec ts;
+	int err = 0;
+	if (t == NULL) return 0;
+	clock_gettime(CLOCK_REALTIME, &ts);
+	ts.tv_sec += ticks / 1000;
+	ts.tv_nsec += (ticks % 1000) * NS_PER_MS;
+	if (ts.tv_nsec >= NS_PER_S) {
+		ts.tv_sec++;
+		ts.tv_nsec -= NS_PER_S;
+	}
+	pthread_mutex_lock(&t->mutex);
+	while (t->notify == 0 && err == 0) {
+		if (ticks == portMAX_DELAY) err = pthread_cond_wait(&t->cond, &t->mutex);
+		else err = pthread_cond_timedwait(&t->cond, &t->mutex, &ts);
+	}
+	uint32_t n = t->notify;
+	if (n) t->notify = clear ? 0 : n-1;
+	pthread_mutex_unlock(&t->mutex);
+	return n;
+}
+
+BaseType_t xTaskNotifyGive(TaskHandle_t t)
+{
+	pthread_mutex_lock(&t->mutex);
+	t->notify++;
+	pthread_cond_signal(&t->cond);
+	pthread_mutex_unlock(&t->mutex);
+	return pdPASS;
+}
+
+void vTaskNotifyGiveFromISR(TaskHandle_t t, BaseType_t *woken)
+{
+	xTaskNotifyGive(t);
+	if (woken) *woken = pdTRUE;
+}
+
+void taskYIELD(void)
+{
+	sched_yield();
+}
@@ -0,0 +1,10 @@
+// Host stand-in for the joy component. The joystick is centered; the
+// game is driven through a replayed input log instead.
+
+#include "joy.h"
+
+int32_t joy_init(void) { return 0; }
+int32_t joy_deinit(void) { return 0; }
+void joy_get_displacement(int32_t *dcx, int32_t *dcy) { *dcx = *dcy = 0; }
+void joy_get_shaped(float *x, float *y) { *x = *y = 0.0f; }
+void joy_set_dead_zone(float thr) {}
@@ -0,0 +1,19 @@
+// Host stand-in for the lcd component. Drawing calls do nothing, so the
+// cost measured on the host is the game logic alone.
+
+#include "lcd.h"
+
+void lcd_init(void) {}
+void lcd_fillScreen(color_t color) {}
+void lcd_drawPixel(coord_t x, coord_t y, color_t color) {}
+void lcd_drawHLine(coord_t x, coord_t y, coord_t w, color_t color) {}
+void lcd_drawVLine(coord_t x, coord_t y, coord_t h, color_t color) {}
+void lcd_drawLine(coord_t x0, coord_t y0, coord_t x1, coord_t y1, color_t color) {}
+void lcd_fillRect(coord_t x, coord_t y, coord_t w, coord_t h, color_t color) {}
+void lcd_fillRect2(coord_t x0, coord_t y0, coord_t x1, coord_t y1, color_t color) {}
+void lcd_fillTriangle(coord_t x0, coord_t y0, coord_t x1, coord_t y1, coord_t x2, coord_t y2, color_t color) {}
+void lcd_fillCircle(coord_t xc, coord_t yc, coord_t r, color_t color) {}
+coord_t lcd_drawString(coord_t x, coord_t y, const char *ascii, color_t color) { return x; }
+void lcd_frameEnable(void) {}
+void lcd_writeFrame(void) {}
+void lcd_writeRect(coord_t x, coord_t y, coord_t w, coord_t h) {}
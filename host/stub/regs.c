@@ -0,0 +1,105 @@
+// Host stand-in for the GPIO and IO_MUX registers and the RTC GPIO
+// driver, used by pin.c.
+
+#include <string.h>
+
+#include "soc/reg_base.h"
+#include "driver/rtc_io.h"
+
+#define REG_BITS 32
+
+// Word index of registers in the GPIO block, see pin.c
+#define OUT        (0x04/4)
+#define OUT_W1TS   (0x08/4)
+#define OUT_W1TC   (0x0C/4)
+#define OUT1       (0x10/4)
+#define OUT1_W1TS  (0x14/4)
+#define OUT1_W1TC  (0x18/4)
+#define ENABLE     (0x20/4)
+#define ENABLE_W1TS  (0x24/4)
+#define ENABLE_W1TC  (0x28/4)
+#define ENABLE1    (0x2C/4)
+#define ENABLE1_W1TS (0x30/4)
+#define ENABLE1_W1TC (0x34/4)
+#define IN         (0x3C/4)
+#define IN1        (0x40/4)
+
+// RTC GPIO pins of the ESP32, one pin per bit
+#define RTC_PINS ( \
+	1LLU << 0 | 1LLU << 2 | 1LLU << 4 | \
+	1LLU << 12 | 1LLU << 13 | 1LLU << 14 | 1LLU << 15 | \
+	1LLU << 25 | 1LLU << 26 | 1LLU << 27 | \
+	0xFFLLU << 32 \
+)
+
+volatile uint32_t host_gpio_regs[HOST_GPIO_REGS];
+volatile uint32_t host_io_mux_regs[HOST_IO_MUX_REGS];
+uint8_t host_rtc_pulls[64];
+
+// Apply the W1TS and W1TC registers to reg and clear them.
+static void latch(uint32_t reg, uint32_t w1ts, uint32_t w1tc)
+{
+	host_gpio_regs[reg] = (host_gpio_regs[reg] | host_gpio_regs[w1ts]) & ~host_gpio_regs[w1tc];
+	host_gpio_regs[w1ts] = 0;
+	host_gpio_regs[w1tc] = 0;
+}
+
+// Clear all registers, as after a chip reset.
+void host_regs_reset(void)
+{
+	memset((void *)host_gpio_regs, 0, sizeof(host_gpio_regs));
+	memset((void *)host_io_mux_regs, 0, sizeof(host_io_mux_regs));
+	memset(host_rtc_pulls, 0, sizeof(host_rtc_pulls));
+}
+
+// Do what the hardware does on a write to a W1TS or W1TC register: set
+// or clear the written bits in the OUT and ENABLE registers, then clear
+// the W1TS and W1TC registers. Call after the code under test writes.
+void host_regs_latch(void)
+{
+	latch(OUT, OUT_W1TS, OUT_W1TC);
+	latch(OUT1, OUT1_W1TS, OUT1_W1TC);
+	latch(ENABLE, ENABLE_W1TS, ENABLE_W1TC);
+	latch(ENABLE1, ENABLE1_W1TS, ENABLE1_W1TC);
+}
+
+// Set the value of the input registers, one pin per bit.
+void host_regs_set_in(uint64_t in)
+{
+	host_gpio_regs[IN] = (uint32_t)in;
+	host_gpio_regs[IN1] = (uint32_t)(in >> REG_BITS);
+}
+
+bool rtc_gpio_is_valid_gpio(int32_t pin)
+{
+	return pin >= 0 && pin < 64 && ((RTC_PINS >> pin) & 1);
+}
+
+esp_err_t rtc_gpio_deinit(int32_t pin)
+{
+	return 0;
+}
+
+esp_err_t rtc_gpio_pullup_en(int32_t pin)
+{
+	host_rtc_pulls[pin] |= HOST_RTC_PULLUP;
+	return 0;
+}
+
+esp_err_t rtc_gpio_pullup_dis(int32_t pin)
+{
+	host_rtc_pulls[pin] &= ~HOST_RTC_PULLUP;
+	return 0;
+}
+
+esp_err_t rtc_gpio_pulldown_en(int32_t pin)
+{
+	host_rtc_pulls[pin] |= HOST_RTC_PULLDOWN;
+	return 0;
+}
+
+esp_err_t rtc_gpio_pulldown_dis(int32_t pin)
+{
+	host_rtc_pulls[pin] &= ~HOST_RTC_PULLDOWN;
+	return 0;
+}
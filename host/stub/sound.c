@@ -0,0 +1,8 @@
+// Host stand-in for the sound component, for programs that only need
+// the game logic. Sounds are not played.
+
+#include "sound.h"
+
+int32_t sound_init(uint32_t sample_hz) { return 0; }
+void sound_start(const void *audio, uint32_t size, bool wait) {}
+void sound_set_volume(uint32_t vol) {}
@@ -6,7 +6,7 @@
 #include "driver/gptimer.h"
 #include "hw.h" // defines I/O pins associated with buttons
 #include "lcd.h"
-#include "pin.h"
+#include "buttons.h"
 #include "watch.h"
 #include "esp_timer.h"
 
@@ -16,7 +16,7 @@
 
 static const char *TAG = "lab03";
 static volatile uint32_t timer_ticks; // global variables initialize to 0 automatically
-static bool running;
+static volatile bool running;
 
 volatile int64_t isr_max; // Maximum ISR execution time (us)
 volatile int32_t isr_cnt; // Count of ISR invocations
@@ -27,13 +27,6 @@ static bool timer_on_alarm_cb(gptimer_handle_t timer, const gptimer_alarm_event_
     start = esp_timer_get_time();
     if (running) timer_ticks++;
 
-    if (!pin_get_level(HW_BTN_A)) running = true;
-    else if (!pin_get_level(HW_BTN_B)) running = false;
-    else if (!pin_get_level(HW_BTN_START)) {
-        running = false;
-        timer_ticks = 0;
-    }
-
     finish = esp_timer_get_time();
     if (finish-start > isr_max) isr_max = finish-start;
     isr_cnt++;
@@ -51,12 +44,7 @@ void app_main(void)
     int64_t start, finish;
     start = esp_timer_get_time();
 
-    pin_reset(HW_BTN_A);
-    pin_reset(HW_BTN_B);
-    pin_reset(HW_BTN_START);
-    pin_input(HW_BTN_A, true);
-    pin_input(HW_BTN_B, true);
-    pin_input(HW_BTN_START, true);
+    buttons_init(1LLU << HW_BTN_A | 1LLU << HW_BTN_B | 1LLU << HW_BTN_START);
 
     finish = esp_timer_get_time();
     printf("Configure I/O pins:%lld microseconds\n", finish-start);
@@ -106,7 +94,17 @@ void app_main(void)
     lcd_init(); // Initialize LCD display
     watch_init(); // Initialize stopwatch face
 
+    buttons_event_t ev;
     for (;;) { // forever update loop
+        while (buttons_get(&ev, 0)) { // Button presses start, stop and reset
+            if (ev.type != BUTTONS_PRESS) continue;
+            if (ev.pin == HW_BTN_A) running = true;
+            else if (ev.pin == HW_BTN_B) running = false;
+            else if (ev.pin == HW_BTN_START) {
+                running = false;
+                timer_ticks = 0;
+            }
+        }
         watch_update(timer_ticks);
         if (isr_cnt >= ISR_COUNT_LIMIT) {
             printf("Stopwatch timer ISR:%lld microseconds\n", isr_max);
@@ -11,16 +11,19 @@
 #include "freertos/task.h"
 #include "esp_log.h"
 #include "esp_check.h"
+#include "nvs_flash.h"
 
 #include "hw.h"
 #include "lcd.h"
-#include "pin.h"
+#include "buttons.h"
 #include "joy.h"
 
 static const char *TAG = "lab04";
 
 #define UP_PER 30 // Update period in ms
 #define TIME_OUT 500 // ms
+#define CAL_MS 5000 // Time to move the joystick around during calibration
+#define BOOT_WAIT 100 // ms for the button driver to read the buttons held
 
 #define PIN_GET_BIT(r,b) (((r) >> (b)) & 1)
 
@@ -49,6 +52,7 @@ typedef enum {SINE_T, SQUARE_T, TRIANGLE_T, SAW_T, LAST_T} tone_t;
 #define tone_set_volume(vol)
 #define tone_start(tone,freq)
 #define sound_start(audio,size,wait)
+#define sound_tap_config(dec)
 #endif // MILESTONE
 
 #define VOL_INC 20 // %
@@ -103,34 +107,36 @@ void draw_tone_status(void)
 #endif // MILESTONE
 }
 
-// Draw the current waveform in the center of the display
+// Draw the sound output in the center of the display, like an
+// oscilloscope. Samples come from the sound tap. The trace starts at a
+// rising crossing of the center so that a steady tone stands still.
 void draw_waveform(void)
 {
 #if MILESTONE == 2
-	extern const uint8_t *abase;
-	extern volatile uint32_t asize;
-	#define WAVE_MAX ((1 << (sizeof(abase[0])*8))-1) // Maximum value
-	float scalex = (float)(WAVE_W/2)/(asize);
-	float scaley = (float)(WAVE_H-1)/WAVE_MAX;
-	#define W2X(val) ((coord_t)((val) * scalex + 0.5f) + WAVE_X)
-	#define W2Y(val) ((WAVE_Y+WAVE_H-1) - (coord_t)((val) * scaley + 0.5f))
-
-	coord_t x0 = W2X(-1);
-	coord_t y0 = W2Y(abase[asize-1]);
-	coord_t x2 = (coord_t)(asize * scalex + 0.5f);
+	static coord_t ly[WAVE_W]; // Previous trace, erased before drawing
+	static bool drawn;
+	uint8_t s[SOUND_TAP_LEN];
+	#define WAVE_MAX UINT8_MAX // Maximum value
+	#define WAVE_MID ((WAVE_MAX+1)/2) // Center value
+	#define W2Y(val) ((WAVE_Y+WAVE_H-1) - (coord_t)((val) * (WAVE_H-1) / WAVE_MAX))
+
+	uint32_t n = sound_tap(s, SOUND_TAP_LEN);
+	uint32_t t = 0;
+	for (uint32_t i = 1; i + WAVE_W <= n; i++)
+		if (s[i-1] < WAVE_MID && s[i] >= WAVE_MID) {t = i; break;}
+
+	for (coord_t x = 1; drawn && x < WAVE_W; x++)
+		lcd_drawLine(WAVE_X+x-1, ly[x-1], WAVE_X+x, ly[x], SBG_CL);
 	lcd_drawHLine(WAVE_X, WAVE_Y, WAVE_W, WAVE_MARK_CL);
 	lcd_drawHLine(WAVE_X, WAVE_Y+WAVE_H-1, WAVE_W, WAVE_MARK_CL);
 	lcd_drawVLine(WAVE_X, WAVE_YC-WAVE_MARK_H/2, WAVE_MARK_H, WAVE_MARK_CL);
-	lcd_drawVLine(WAVE_X+x2, WAVE_YC-WAVE_MARK_H/2, WAVE_MARK_H, WAVE_MARK_CL);
-	for (uint32_t i = 0; i < asize; i++) {
-		coord_t x1 = W2X(i);
-		coord_t y1 = W2Y(abase[i]);
-		lcd_drawPixel(x1, WAVE_YC, WAVE_MARK_CL);
-		lcd_drawPixel(x1+x2, WAVE_YC, WAVE_MARK_CL);
-		lcd_drawLine(x0, y0, x1, y1, WAVE_CL);
-		lcd_drawLine(x0+x2, y0, x1+x2, y1, WAVE_CL);
-		x0 = x1; y0 = y1;
+	ly[0] = W2Y(s[t]);
+	for (coord_t x = 1; x < WAVE_W; x++) {
+		ly[x] = W2Y(s[t+x]);
+		lcd_drawPixel(WAVE_X+x, WAVE_YC, WAVE_MARK_CL);
+		lcd_drawLine(WAVE_X+x-1, ly[x-1], WAVE_X+x, ly[x], WAVE_CL);
 	}
+	drawn = true;
 #endif // MILESTONE
 }
 
@@ -140,27 +146,31 @@ void update(TimerHandle_t pxTimer)
 	static coord_t lx = -1, ly = -1;
 	coord_t x, y;
 	static bool pressed = false;
+	buttons_event_t ev;
 	uint64_t btns;
 
 	joy_get_displacement(&dcx, &dcy);
-	btns = ~pin_get_in_reg() & HW_BTN_MASK;
-	if (!pressed && btns) { // On button press
-		pressed = true;
-		if (PIN_GET_BIT(btns, HW_BTN_A)) { // Play tone
+	while (buttons_get(&ev, 0)) {
+		if (ev.type != BUTTONS_PRESS || pressed) continue;
+		pressed = true; // First button down, others ignored until release
+		if (ev.pin == HW_BTN_A) { // Play tone
 			tone_start(tone, (dcy > 0) ?
 				A4-(dcy*A3)/JOY_MAX_DISP :
 				A4-(dcy*A4)/JOY_MAX_DISP);
 			cursor(lx, ly, SBG_CL); // Erase cursor
-			draw_waveform();
-		} else if (PIN_GET_BIT(btns, HW_BTN_B)) { // Play user sound
+		} else if (ev.pin == HW_BTN_B) { // Play user sound
 			sound_start(userSound, sizeof(userSound), false);
-		} else if (PIN_GET_BIT(btns, HW_BTN_MENU)) { // Select next tone
+		} else if (ev.pin == HW_BTN_MENU) { // Select next tone
 			tone = (tone+1)%LAST_T;
-		} else if (PIN_GET_BIT(btns, HW_BTN_OPTION)) { // Select next volume level
+		} else if (ev.pin == HW_BTN_OPTION) { // Select next volume level
 			vol = (vol <= MAX_VOL-VOL_INC) ? vol+VOL_INC : 0;
 			tone_set_volume(vol);
 		}
 		draw_tone_status();
+	}
+	btns = buttons_state();
+	if (pressed && PIN_GET_BIT(btns, HW_BTN_A)) { // While tone plays
+		draw_waveform();
 	} else if (pressed && !btns) { // On button release, stop playing sound
 		tone_stop();
 		pressed = false;
@@ -183,24 +193,47 @@ void update(TimerHandle_t pxTimer)
 	}
 }
 
+// Initialize NVS, where the joystick calibration is kept. If the NVS
+// partition is full or from a newer version, it is erased.
+void nvs_init(void)
+{
+	esp_err_t err = nvs_flash_init();
+	if (err == ESP_ERR_NVS_NO_FREE_PAGES || err == ESP_ERR_NVS_NEW_VERSION_FOUND) {
+		ESP_ERROR_CHECK(nvs_flash_erase());
+		err = nvs_flash_init();
+	}
+	if (err != ESP_OK) ESP_LOGE(TAG, "nvs_flash_init: %s", esp_err_to_name(err));
+}
+
+// Calibrate the joystick if START is held down at power-up, or erase the
+// saved calibration if SELECT is held down.
+void joystick_setup(void)
+{
+	uint64_t btns = buttons_state();
+
+	if (PIN_GET_BIT(btns, HW_BTN_START)) {
+		lcd_drawString(0, LCD_H/2, "Calibrating: release START,", STB_CL);
+		lcd_drawString(0, LCD_H/2+LCD_CHAR_H, "then move the joystick in circles", STB_CL);
+		while (PIN_GET_BIT(buttons_state(), HW_BTN_START)) vTaskDelay(pdMS_TO_TICKS(UP_PER));
+		if (joy_calibrate(CAL_MS)) ESP_LOGE(TAG, "Joystick calibration failed");
+		else ESP_LOGI(TAG, "Joystick calibration saved");
+		lcd_fillScreen(SBG_CL);
+	} else if (PIN_GET_BIT(btns, HW_BTN_SELECT)) {
+		if (joy_cal_erase()) ESP_LOGE(TAG, "Joystick calibration not erased");
+		else ESP_LOGI(TAG, "Joystick calibration erased");
+	}
+}
+
 // Main application
+// Hold START at power-up to calibrate the joystick, or SELECT to erase
+// the calibration.
 void app_main(void)
 {
 	ESP_LOGI(TAG, "Start up");
+	nvs_init(); // Before joy_init(), for the joystick calibration
 
 	// Configure I/O pins for buttons
-	pin_reset(HW_BTN_A);
-	pin_input(HW_BTN_A, true);
-	pin_reset(HW_BTN_B);
-	pin_input(HW_BTN_B, true);
-	pin_reset(HW_BTN_MENU);
-	pin_input(HW_BTN_MENU, true);
-	pin_reset(HW_BTN_OPTION);
-	pin_input(HW_BTN_OPTION, true);
-	pin_reset(HW_BTN_SELECT);
-	pin_input(HW_BTN_SELECT, true);
-	pin_reset(HW_BTN_START);
-	pin_input(HW_BTN_START, true);
+	buttons_init(HW_BTN_MASK);
 
 	lcd_init(); // Initialize LCD display and device handle
 	lcd_fillScreen(SBG_CL); // Clear the screen
@@ -210,9 +243,12 @@ void app_main(void)
 	tone = SINE_T;
 	tone_init(SAMPLE_RATE); // Initialize tone and sample rate
 	tone_set_volume(vol); // Set the volume
-	draw_tone_status();
+	sound_tap_config(1); // Keep every output sample for draw_waveform()
 
 	joy_init(); // Initialize joystick driver
+	vTaskDelay(pdMS_TO_TICKS(BOOT_WAIT));
+	joystick_setup();
+	draw_tone_status();
 	draw_joystick_status();
 
 	// Schedule the tick() function to run at the specified period.
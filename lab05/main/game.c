@@ -1,7 +1,7 @@
 #include "game.h"
 #include "nav.h"
 #include "board.h"
-#include "pin.h"
+#include "buttons.h"
 #include "hw.h"
 #include "graphics.h"
 #include "lcd.h"
@@ -30,6 +30,8 @@ void game_init(void) {
 
 // Update the game logic.
 void game_tick(void) {
+    uint64_t press = buttons_pressed(); // Buttons pressed since last tick
+
     // state transitions
     switch(state) {
         case init_st:
@@ -41,7 +43,7 @@ void game_tick(void) {
         case wait_mark_st:
         uint8_t buffer[1];
             // Wait for a mark (Button A press) from a player
-            if (!pin_get_level(HW_BTN_A)) {
+            if (press & 1LLU << HW_BTN_A) {
                 // Get the navigator location
                 nav_get_loc(&r, &c);
                 // Check if the location is valid
@@ -105,7 +107,7 @@ void game_tick(void) {
             break;
         case wait_restart_st:
             // Wait for a restart (Start Button press)
-            if (!pin_get_level(HW_BTN_START)) {
+            if (press & 1LLU << HW_BTN_START) {
                 // Transition to new_game_st
                 state = new_game_st;
             }
@@ -6,7 +6,7 @@
 #include "esp_timer.h"
 
 #include "hw.h"
-#include "pin.h"
+#include "buttons.h"
 #include "lcd.h"
 #include "nav.h"
 #if MILESTONE == 2
@@ -53,18 +53,7 @@ void app_main(void)
 	game_init();
 
 	// Configure I/O pins for buttons
-	pin_reset(HW_BTN_A);
-	pin_input(HW_BTN_A, true);
-	pin_reset(HW_BTN_B);
-	pin_input(HW_BTN_B, true);
-	pin_reset(HW_BTN_MENU);
-	pin_input(HW_BTN_MENU, true);
-	pin_reset(HW_BTN_OPTION);
-	pin_input(HW_BTN_OPTION, true);
-	pin_reset(HW_BTN_SELECT);
-	pin_input(HW_BTN_SELECT, true);
-	pin_reset(HW_BTN_START);
-	pin_input(HW_BTN_START, true);
+	buttons_init(HW_BTN_MASK);
 
 	// Initialize update timer
 	update_timer = xTimerCreate(
@@ -86,7 +75,7 @@ void app_main(void)
 	// Main game loop
 	uint64_t t1, t2, tmax = 0; // For hardware timer values
 	int8_t r, c; // For navigator location
-	while (pin_get_level(HW_BTN_MENU)) // while MENU button not pressed
+	while (!(buttons_state() & 1LLU << HW_BTN_MENU)) // while MENU button not pressed
 	{
 		while (!interrupt_flag) ;
 		t1 = esp_timer_get_time();
@@ -1,5 +1,5 @@
 
-#include <stdlib.h> // abs
+#include <math.h> // fabsf
 #include <stdbool.h>
 
 #include "joy.h"
@@ -11,12 +11,11 @@
 
 // The sensitivity constant is in cells/sec and is converted to grids/sec
 #define SEN_DEFAULT (3.0f/CONFIG_BOARD_C) // Grid widths per second
-#define THRESH_DEFAULT 0.75f // Raw ADC values
+#define THRESH_DEFAULT 0.075f // Factor of maximum displacement
 #define CLIP(x,lo,hi) ((x) < (lo) ? (lo) : ((x) > (hi) ? (hi) : (x)))
 
 static uint32_t uperiod; // Update period in milliseconds.
 static float sfactor; // Joystick sensitivity factor.
-static uint32_t thresh; // Joystick displacement threshold.
 static float rloc, cloc; // Current navigator location as a float.
 
 
@@ -44,11 +43,11 @@ int32_t nav_init(uint32_t per)
 void nav_tick(void)
 {
 	static bool last_move = false;
-	int32_t dcx, dcy;
+	float dx, dy;
 
-	// Get joystick position relative to the center in raw ADC values.
-	joy_get_displacement(&dcx, &dcy);
-	if (abs(dcx) < thresh && abs(dcy) < thresh) {
+	// Get filtered joystick displacement with dead zone and response curve.
+	joy_get_shaped(&dx, &dy);
+	if (dx == 0.0f && dy == 0.0f) {
 		rloc = (int)(rloc+0.5f);
 		cloc = (int)(cloc+0.5f);
 		last_move = false;
@@ -58,14 +57,15 @@ void nav_tick(void)
 	// Based on the joystick position relative to center,
 	// calculate a new location for the navigator.
 	if (last_move) {
-		rloc += dcy*sfactor;
-		cloc += dcx*sfactor;
+		rloc += dy*sfactor;
+		cloc += dx*sfactor;
 	} else {
-		// Provides bump on first move.
-		if (abs(dcy) >= thresh)
-			rloc += (dcy < 0) ? -0.5f : +0.5f;
-		if (abs(dcx) >= thresh)
-			cloc += (dcx < 0) ? -0.5f : +0.5f;
+		// Provides bump on first move, along the main axis or both
+		// if the push is near diagonal.
+		if (fabsf(dy) >= fabsf(dx)/2)
+			rloc += (dy < 0) ? -0.5f : +0.5f;
+		if (fabsf(dx) >= fabsf(dy)/2)
+			cloc += (dx < 0) ? -0.5f : +0.5f;
 	}
 
 	// Clip new location to grid.
@@ -82,7 +82,7 @@ void nav_tick(void)
 void nav_set_sensitivity(float sens)
 {
 	float rate = sens*GRID_C; // Convert to cells per second
-	sfactor = rate / JOY_MAX_DISP * uperiod / 1000;
+	sfactor = rate * uperiod / 1000;
 }
 
 // Set the threshold of joystick displacement needed before moving the navigator.
@@ -92,7 +92,7 @@ void nav_set_sensitivity(float sens)
 // thr: threshold factor (0 to 1)
 void nav_set_threshold(float thr)
 {
-	thresh = thr*JOY_MAX_DISP; // Convert to raw ADC values
+	joy_set_dead_zone(thr); // Radial, shared with the joystick stage
 }
 
 // Get the navigator location.
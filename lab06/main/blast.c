@@ -0,0 +1,54 @@
+#include "lcd.h"
+#include "blast.h"
+
+#define CLIP_R(r) (((r) > BLAST_R_MAX) ? BLAST_R_MAX : (r))
+
+// span[r][dy]: half width of row dy (up or down) of the circle of radius r
+static uint8_t span[BLAST_R_MAX+1][BLAST_R_MAX+1];
+
+
+// Compute the span table. Must be called before the other functions.
+void blast_init(void)
+{
+	for (coord_t r = 0; r <= BLAST_R_MAX; r++) {
+		// Same steps as lcd_fillCircle(), which fills columns x (left
+		// and right) from row y to -y. A row's half width is the last
+		// column that reaches it.
+		coord_t x = 0, y = -r, err = 2-2*r, old_err;
+		bool change_x = true;
+		do {
+			if (change_x)
+				for (coord_t j = 0; j <= -y; j++) span[r][j] = x;
+			change_x = (old_err = err) <= x;
+			if (change_x) err += ++x*2+1;
+			if (old_err > y || err > x) err += ++y*2+1;
+		} while (y <= 0);
+	}
+}
+
+// Draw an explosion.
+// x, y: center.
+// r: radius in whole pixels, nothing is drawn if negative.
+void blast_draw(coord_t x, coord_t y, coord_t r, color_t color)
+{
+	if (r < 0) return;
+	r = CLIP_R(r);
+	const uint8_t *s = span[r];
+	lcd_drawHLine(x - s[0], y, 2*s[0]+1, color);
+	for (coord_t j = 1; j <= r; j++) {
+		lcd_drawHLine(x - s[j], y - j, 2*s[j]+1, color);
+		lcd_drawHLine(x - s[j], y + j, 2*s[j]+1, color);
+	}
+}
+
+// Return whether a point is inside an explosion.
+// dx, dy: position of the point from the center.
+// r: radius in whole pixels, there is no hit if negative.
+bool blast_hit(coord_t dx, coord_t dy, coord_t r)
+{
+	if (r < 0) return false;
+	r = CLIP_R(r);
+	if (dy < 0) dy = -dy;
+	if (dx < 0) dx = -dx;
+	return dy <= r && dx <= span[r][dy];
+}
@@ -0,0 +1,31 @@
+#ifndef BLAST_H_
+#define BLAST_H_
+
+#include <stdbool.h>
+
+#include "lcd.h" // coord_t, color_t
+#include "config.h"
+
+// Explosions are filled circles with a radius in whole pixels. The
+// circle of each radius up to BLAST_R_MAX is computed once by
+// blast_init(), with the same pixels as lcd_fillCircle(), and kept as a
+// table of spans: the half width of each row. Drawing an explosion draws
+// its spans, and a hit test looks up the span of one row, so a hit is
+// exactly a pixel that is drawn.
+
+#define BLAST_R_MAX CONFIG_EXPLOSION_MAX_RADIUS // Larger radii are clipped
+
+// Compute the span table. Must be called before the other functions.
+void blast_init(void);
+
+// Draw an explosion.
+// x, y: center.
+// r: radius in whole pixels, nothing is drawn if negative.
+void blast_draw(coord_t x, coord_t y, coord_t r, color_t color);
+
+// Return whether a point is inside an explosion.
+// dx, dy: position of the point from the center.
+// r: radius in whole pixels, there is no hit if negative.
+bool blast_hit(coord_t dx, coord_t dy, coord_t r);
+
+#endif // BLAST_H_
@@ -0,0 +1,79 @@
+#include "lcd.h"
+#include "config.h"
+#include "missile.h" // MISSILE_POOL_MAX
+#include "blast.h"
+#include "collide.h"
+
+#define CELL_SZ (1 << COLLIDE_CELL_SHIFT)
+#define GRID_W ((LCD_W + CELL_SZ - 1) >> COLLIDE_CELL_SHIFT)
+#define GRID_H ((LCD_H + CELL_SZ - 1) >> COLLIDE_CELL_SHIFT)
+#define NONE UINT16_MAX // End of a cell list
+
+#define CLIP(x,lo,hi) ((x) < (lo) ? (lo) : ((x) > (hi) ? (hi) : (x)))
+
+#if MISSILE_POOL_MAX >= NONE
+#error "MISSILE_POOL_MAX is too large for the cell lists"
+#endif
+
+#if BLAST_R_MAX > CELL_SZ
+#error "COLLIDE_CELL_SHIFT is too small for CONFIG_EXPLOSION_MAX_RADIUS"
+#endif
+
+// An explosion binned in the grid
+typedef struct {
+	coord_t x, y;
+	coord_t r; // Radius in whole pixels
+} boom_t;
+
+static uint16_t head[GRID_H][GRID_W]; // First explosion in each cell
+static uint16_t next[MISSILE_POOL_MAX]; // Next explosion in the cell
+static boom_t boom[MISSILE_POOL_MAX];
+static uint32_t boom_n; // Explosions in the grid
+
+// Return the grid column or row of a coordinate. Points off the screen
+// fall in the nearest edge cell, which keeps neighbors within one cell.
+static inline int32_t cell(coord_t v, int32_t max)
+{
+	return CLIP(v >> COLLIDE_CELL_SHIFT, 0, max-1);
+}
+
+// Remove all explosions from the grid.
+void collide_clear(void)
+{
+	for (uint32_t cy = 0; cy < GRID_H; cy++)
+		for (uint32_t cx = 0; cx < GRID_W; cx++)
+			head[cy][cx] = NONE;
+	boom_n = 0;
+}
+
+// Add an explosion to the grid. Explosions beyond MISSILE_POOL_MAX since
+// the last collide_clear() are ignored.
+// x, y: center of the explosion.
+// r: radius in whole pixels, negative for none.
+void collide_add(coord_t x, coord_t y, coord_t r)
+{
+	if (boom_n >= MISSILE_POOL_MAX || r < 0) return;
+	int32_t cx = cell(x, GRID_W);
+	int32_t cy = cell(y, GRID_H);
+	boom[boom_n] = (boom_t){x, y, r};
+	next[boom_n] = head[cy][cx];
+	head[cy][cx] = boom_n++;
+}
+
+// Return whether an object (e.g., missile or plane) at the specified
+// (x,y) position is within the radius of any explosion in the grid.
+bool collide_hit(coord_t x, coord_t y)
+{
+	int32_t cx = cell(x, GRID_W), cy = cell(y, GRID_H);
+	int32_t x0 = (cx > 0) ? cx-1 : 0, x1 = (cx < GRID_W-1) ? cx+1 : GRID_W-1;
+	int32_t y0 = (cy > 0) ? cy-1 : 0, y1 = (cy < GRID_H-1) ? cy+1 : GRID_H-1;
+
+	for (int32_t j = y0; j <= y1; j++) {
+		for (int32_t i = x0; i <= x1; i++) {
+			for (uint16_t k = head[j][i]; k != NONE; k = next[k]) {
+				if (blast_hit(x - boom[k].x, y - boom[k].y, boom[k].r)) return true;
+			}
+		}
+	}
+	return false;
+}
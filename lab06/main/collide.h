@@ -0,0 +1,30 @@
+#ifndef COLLIDE_H_
+#define COLLIDE_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "lcd.h" // coord_t
+
+// Collision detection against explosions using a uniform grid. Each
+// tick, the explosions are cleared and added again, binned by the grid
+// cell of their center. A cell is at least as large as the largest
+// explosion, so collide_hit() only needs to look at the 3x3 cells around
+// a point. A hit is a pixel of the explosion as drawn, see blast.h.
+
+#define COLLIDE_CELL_SHIFT 5 // Cell size is 1 << COLLIDE_CELL_SHIFT pixels
+
+// Remove all explosions from the grid.
+void collide_clear(void);
+
+// Add an explosion to the grid. Explosions beyond MISSILE_POOL_MAX since
+// the last collide_clear() are ignored.
+// x, y: center of the explosion.
+// r: radius in whole pixels, negative for none.
+void collide_add(coord_t x, coord_t y, coord_t r);
+
+// Return whether an object (e.g., missile or plane) at the specified
+// (x,y) position is within the radius of any explosion in the grid.
+bool collide_hit(coord_t x, coord_t y);
+
+#endif // COLLIDE_H_
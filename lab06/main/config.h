@@ -3,8 +3,13 @@
 
 #define CONFIG_GAME_TIMER_PERIOD 40.0E-3f
 
+// Render incrementally: only the changes are drawn over the last frame
+// and only the changed parts are written to the display. Comment out to
+// clear, draw and write the whole frame each time.
+#define CONFIG_ERASE
+
 #define CONFIG_MAX_PLAYER_MISSILES 4
-#define CONFIG_MAX_ENEMY_MISSILES  7
+#define CONFIG_MAX_ENEMY_MISSILES  10 // Most in any wave, see CONFIG_WAVES
 #define CONFIG_MAX_PLANE_MISSILES  1
 #define CONFIG_MAX_TOTAL_MISSILES  \
   (CONFIG_MAX_ENEMY_MISSILES +     \
@@ -41,6 +46,19 @@
 #define CONFIG_PLANE_WIDTH  20
 #define CONFIG_PLANE_HEIGHT 10
 
+// Attack waves, see wave_t. Each wave is {length, enemy missiles in
+// flight, launch interval, plane idle time}, in ticks. The last wave
+// lasts until the game ends.
+#define CONFIG_SECONDS_TO_TICKS(s) ((uint32_t)((s) / CONFIG_GAME_TIMER_PERIOD))
+#define CONFIG_WAVES { \
+  {CONFIG_SECONDS_TO_TICKS(20.0f), 4, CONFIG_SECONDS_TO_TICKS(1.0f), \
+   CONFIG_PLANE_IDLE_TIME_TICKS}, \
+  {CONFIG_SECONDS_TO_TICKS(30.0f), 7, CONFIG_SECONDS_TO_TICKS(0.4f), \
+   CONFIG_PLANE_IDLE_TIME_TICKS}, \
+  {0, CONFIG_MAX_ENEMY_MISSILES, CONFIG_SECONDS_TO_TICKS(0.2f), \
+   CONFIG_PLANE_IDLE_TIME_TICKS/2}, \
+}
+
 // Colors
 #define CONFIG_COLOR_BACKGROUND rgb565(0, 4, 16)
 
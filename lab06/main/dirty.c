@@ -0,0 +1,129 @@
+#include "lcd.h"
+#include "dirty.h"
+
+// Changes are merged with a rectangle they touch, so the common case of
+// an object moving a little each frame stays one rectangle. When a list
+// is full, a new rectangle is merged with the one that grows the least.
+
+#define FULL_PCT 50 // Write the whole frame above this percent changed
+
+#define MIN(a,b) ((a) < (b) ? (a) : (b))
+#define MAX(a,b) ((a) > (b) ? (a) : (b))
+
+typedef struct {
+	coord_t x0, y0, x1, y1;
+} rect_t;
+
+typedef struct {
+	rect_t r[DIRTY_MAX];
+	uint32_t n, max;
+} rects_t;
+
+static rects_t dirty = {.max = DIRTY_MAX};
+static rects_t damage = {.max = DAMAGE_MAX};
+
+
+static int32_t area(const rect_t *r)
+{
+	return (r->x1 - r->x0 + 1) * (r->y1 - r->y0 + 1);
+}
+
+// Return the union of two rectangles.
+static rect_t join(const rect_t *a, const rect_t *b)
+{
+	return (rect_t){MIN(a->x0, b->x0), MIN(a->y0, b->y0),
+		MAX(a->x1, b->x1), MAX(a->y1, b->y1)};
+}
+
+// Return whether two rectangles overlap or are next to each other.
+static bool touch(const rect_t *a, const rect_t *b)
+{
+	return a->x0 <= b->x1+1 && b->x0 <= a->x1+1 &&
+		a->y0 <= b->y1+1 && b->y0 <= a->y1+1;
+}
+
+// Add a rectangle to a list, merged with one it touches if any.
+static void rects_add(rects_t *l, rect_t r)
+{
+	uint32_t best = 0;
+	int32_t grow, best_grow = INT32_MAX;
+
+	// Clip to the screen
+	r.x0 = MAX(r.x0, 0); r.y0 = MAX(r.y0, 0);
+	r.x1 = MIN(r.x1, LCD_W-1); r.y1 = MIN(r.y1, LCD_H-1);
+	if (r.x0 > r.x1 || r.y0 > r.y1) return;
+
+	for (uint32_t i = 0; i < l->n; i++) {
+		if (touch(l->r+i, &r)) {
+			l->r[i] = join(l->r+i, &r);
+			return;
+		}
+	}
+	if (l->n < l->max) {
+		l->r[l->n++] = r;
+		return;
+	}
+	for (uint32_t i = 0; i < l->n; i++) {
+		rect_t u = join(l->r+i, &r);
+		grow = area(&u) - area(l->r+i);
+		if (grow < best_grow) {
+			best_grow = grow;
+			best = i;
+		}
+	}
+	l->r[best] = join(l->r+best, &r);
+}
+
+// Mark a rectangle of the frame as changed.
+void dirty_add(coord_t x0, coord_t y0, coord_t x1, coord_t y1)
+{
+	rects_add(&dirty, (rect_t){x0, y0, x1, y1});
+}
+
+// Fill a rectangle of the frame with a color, mark it as changed and as
+// damaged.
+void dirty_erase(coord_t x0, coord_t y0, coord_t x1, coord_t y1, color_t color)
+{
+	lcd_fillRect2(x0, y0, x1, y1, color);
+	dirty_damage(x0, y0, x1, y1);
+}
+
+// Mark a rectangle of the frame as changed and as damaged, for an area
+// erased by the caller (e.g., a trail drawn in the background color).
+void dirty_damage(coord_t x0, coord_t y0, coord_t x1, coord_t y1)
+{
+	rects_add(&dirty, (rect_t){x0, y0, x1, y1});
+	rects_add(&damage, (rect_t){x0, y0, x1, y1});
+}
+
+// Return whether a rectangle overlaps an area erased since the last
+// flush.
+bool dirty_hit(coord_t x0, coord_t y0, coord_t x1, coord_t y1)
+{
+	for (uint32_t i = 0; i < damage.n; i++) {
+		const rect_t *d = damage.r+i;
+		if (x0 <= d->x1 && d->x0 <= x1 && y0 <= d->y1 && d->y0 <= y1)
+			return true;
+	}
+	return false;
+}
+
+// Write the changed rectangles of the frame to the display and clear
+// the changes and damage. The whole frame is written if that is less
+// work.
+void dirty_flush(void)
+{
+	int32_t sum = 0;
+
+	for (uint32_t i = 0; i < dirty.n; i++) sum += area(dirty.r+i);
+	if (sum*100 > LCD_W*LCD_H*FULL_PCT) {
+		lcd_writeFrame();
+	} else {
+		for (uint32_t i = 0; i < dirty.n; i++) {
+			const rect_t *r = dirty.r+i;
+			lcd_writeRect(r->x0, r->y0, r->x1-r->x0+1, r->y1-r->y0+1);
+		}
+	}
+	dirty.n = 0;
+	damage.n = 0;
+}
@@ -0,0 +1,38 @@
+#ifndef DIRTY_H_
+#define DIRTY_H_
+
+#include <stdbool.h>
+
+#include "lcd.h" // coord_t, color_t
+
+// Tracking of the parts of the frame that changed, for incremental
+// rendering. Only the changed rectangles are written to the display by
+// dirty_flush(). Rectangles erased to the background are also kept as
+// damage until the flush, so objects drawn incrementally can tell with
+// dirty_hit() that they must be drawn again in full.
+// Rectangles are given by two corners, inclusive.
+
+#define DIRTY_MAX 32 // Changed rectangles kept before they are merged
+#define DAMAGE_MAX 16 // Erased rectangles kept before they are merged
+
+// Mark a rectangle of the frame as changed.
+void dirty_add(coord_t x0, coord_t y0, coord_t x1, coord_t y1);
+
+// Fill a rectangle of the frame with a color, mark it as changed and as
+// damaged.
+void dirty_erase(coord_t x0, coord_t y0, coord_t x1, coord_t y1, color_t color);
+
+// Mark a rectangle of the frame as changed and as damaged, for an area
+// erased by the caller (e.g., a trail drawn in the background color).
+void dirty_damage(coord_t x0, coord_t y0, coord_t x1, coord_t y1);
+
+// Return whether a rectangle overlaps an area erased since the last
+// flush.
+bool dirty_hit(coord_t x0, coord_t y0, coord_t x1, coord_t y1);
+
+// Write the changed rectangles of the frame to the display and clear
+// the changes and damage. The whole frame is written if that is less
+// work.
+void dirty_flush(void);
+
+#endif // DIRTY_H_
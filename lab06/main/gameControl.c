@@ -1,14 +1,18 @@
 
 #include <stdio.h>
-#include <stdlib.h> // rand
+#include <string.h> // strlen
 
 #include "hw.h"
 #include "lcd.h"
 #include "cursor.h"
 #include "sound.h"
-#include "pin.h"
+#include "input.h"
 #include "missile.h"
+#include "collide.h"
 #include "plane.h"
+#include "dirty.h"
+#include "wave.h"
+#include "rng.h"
 #include "gameControl.h"
 #include "config.h"
 #include "missileLaunch.h"
@@ -23,132 +27,133 @@
 #define VOLUME 20
 #define STATUS_SIZE 20
 
-// All missiles
-missile_t missiles[CONFIG_MAX_TOTAL_MISSILES];
+// Attack waves
+static const wave_t waves[] = CONFIG_WAVES;
 
-// Alias into missiles array
-missile_t *enemy_missiles = missiles+0;
-missile_t *player_missiles = missiles+CONFIG_MAX_ENEMY_MISSILES;
-missile_t *plane_missile = missiles+CONFIG_MAX_ENEMY_MISSILES+
-									CONFIG_MAX_PLAYER_MISSILES;
+// Random numbers of the game, for all launches
+static rng_t rng;
 
-// One shot button protection
-static bool pressed = false;
 coord_t x, y;
-uint64_t btns;
 
 // M3: Declare stats variables
 uint32_t shot;
 uint32_t impacted;
 
+#ifdef CONFIG_ERASE
+// Stats on the screen
+uint32_t drawn_shot;
+uint32_t drawn_impacted;
+
+// Get the bottom right corner of a status string drawn at x.
+static void status_box(coord_t x, const char *s, coord_t *x1, coord_t *y1)
+{
+	*x1 = x + strlen(s)*LCD_CHAR_W - 1;
+	*y1 = STATUS_Y_POS + LCD_CHAR_H - 1;
+}
+#endif // CONFIG_ERASE
+
 // Initialize the game control logic.
 // This function initializes all missiles, planes, stats, etc.
-void gameControl_init(void)
+// seed: seed for the random numbers of the game. The same seed and
+// input give the same game.
+void gameControl_init(uint32_t seed)
 {
-	// Initialize missiles
-	for (uint32_t i = 0; i < CONFIG_MAX_ENEMY_MISSILES; i++)
-		missile_init_enemy(enemy_missiles+i);
-	for (uint32_t i = 0; i < CONFIG_MAX_PLAYER_MISSILES; i++)
-		missile_init_idle(player_missiles+i);
-	missile_init_idle(plane_missile);
+	rng_seed(&rng, seed);
+
+	// Initialize missiles, all free in the pool
+	missiles_init(CONFIG_MAX_TOTAL_MISSILES, &rng);
 
 	// M3: Initialize plane
-	plane_init(plane_missile);
+	plane_init(&rng);
+
+	// Start the first wave, which launches the enemy missiles
+	wave_init(waves, sizeof(waves)/sizeof(waves[0]));
 
 	// M3: Initialize stats
 	shot = 0;
 	impacted = 0;
+#ifdef CONFIG_ERASE
+	drawn_shot = drawn_impacted = UINT32_MAX;
+#endif // CONFIG_ERASE
 
 	// M3: Set sound volume
 	sound_set_volume(VOLUME);
 }
 
 // Update the game control logic.
-// This function calls the missile & plane tick functions, reinitializes
-// idle enemy missiles, handles button presses, fires player missiles,
-// detects collisions, and updates statistics.
+// This function calls the missile, wave & plane tick functions, handles
+// button presses, fires player missiles, detects collisions, and updates
+// statistics.
 void gameControl_tick(void)
 {
-	// Tick missiles in one batch
-	for (uint32_t i = 0; i < CONFIG_MAX_TOTAL_MISSILES; i++)
-		missile_tick(missiles+i);
+	missile_t m;
 
-	// Reinitialize idle enemy missiles
-	for (uint32_t i = 0; i < CONFIG_MAX_ENEMY_MISSILES; i++)
-		if (missile_is_idle(enemy_missiles+i))
-			missile_init_enemy(enemy_missiles+i);
+	// Tick missiles in one batch. M3: Count non-player impacted missiles
+	impacted += missiles_tick();
+
+	// Launch the enemy missiles and the plane that are due
+	wave_tick();
 
 	// M2: Check for button press. If so, launch a free player missile.
-	btns = ~pin_get_in_reg() & HW_BTN_MASK;
-	if (!pressed && btns) {
-		pressed = true; // button pressed
+	if (input_pressed() &&
+		missiles_count(MISSILE_TYPE_PLAYER) < CONFIG_MAX_PLAYER_MISSILES &&
+		missile_alloc(&m)) {
+		// Launch the player missile to the target (x,y) position.
 		cursor_get_pos(&x, &y);
-		// Check to see if a player missile is idle and launch it to the target (x,y) position.
-		for (uint32_t i = 0; i < CONFIG_MAX_PLAYER_MISSILES; i++) {
-			if (missile_is_idle(player_missiles+i)) {
-				missile_init_player(player_missiles+i, x, y);
-				sound_start(missileLaunch, sizeof(missileLaunch), false);
-				shot++;
-				break;
-			}
-		}
-
-	} else if (pressed && !btns) {
-		pressed = false; // all released
+		missile_init_player(&m, x, y);
+		sound_start(missileLaunch, sizeof(missileLaunch), false);
+		shot++;
 	}
 
 	// M2: Check for moving non-player missile collision with an explosion.
-	for (uint32_t i = 0; i < CONFIG_MAX_TOTAL_MISSILES; i++) {
-
-		// skip player missiles
-		if (i == CONFIG_MAX_ENEMY_MISSILES) {
-			i += CONFIG_MAX_PLAYER_MISSILES;
-			if (i >= CONFIG_MAX_TOTAL_MISSILES) {  // Just safety in case max plane missiles == 0
-				break;
-			}
-		}
-
-		if (missile_is_moving(missiles+i)) {
-			for (uint32_t j = 0; j < CONFIG_MAX_TOTAL_MISSILES; j++) {
-				if (missile_is_exploding(missiles+j)) {
-					missile_t* missile = missiles+i;
-					if (missile_is_colliding(missiles+j, missile->x_current, missile->y_current)) {
-						missile_explode(missile);
-					}
-				}
-			}
-		}
-	}
+	// Explosions are binned in a grid so each missile is only tested
+	// against the explosions near it.
+	missiles_collide();
 
-	// M3: Count non-player impacted missiles
-	for (uint32_t i = 0; i < CONFIG_MAX_ENEMY_MISSILES; i++) {
-		if (missile_is_impacted(enemy_missiles+i)) {
-			impacted++;
-		}
-	}
-
-	if (missile_is_impacted(plane_missile)) {
-		impacted++;
-	}
-		
-	// M3: Tick plane & draw stats
+	// M3: Tick plane
 	plane_tick();
-	char status[STATUS_SIZE];
-	sprintf(status, "Shot: %ld", shot);
-	lcd_drawString(STATUS_X_POS, STATUS_Y_POS, status, CONFIG_COLOR_STATUS);
-	sprintf(status, "Impacted: %ld", impacted);
-	lcd_drawString(STATUS_X_POS2, STATUS_Y_POS, status, CONFIG_COLOR_STATUS);
 
 	// M3: Check for flying plane collision with an explosion.
 	if (plane_is_flying()) {
 		plane_get_pos(&x, &y);
-		for (uint32_t i = 0; i < CONFIG_MAX_TOTAL_MISSILES; i++) {
-			if (missile_is_exploding(missiles+i)) {
-				if (missile_is_colliding(missiles+i, x, y)) {
-					plane_explode();
-					break;
-				}
-			}
-		}
+		if (collide_hit(x, y)) plane_explode();
+	}
+}
+
+// Draw the game: missiles, plane and statistics. Called once per frame,
+// which may follow more than one call to gameControl_tick().
+void gameControl_draw(void)
+{
+	char shot_s[STATUS_SIZE], impacted_s[STATUS_SIZE];
+
+	sprintf(shot_s, "Shot: %ld", shot);
+	sprintf(impacted_s, "Impacted: %ld", impacted);
+#ifdef CONFIG_ERASE
+	coord_t x1, y1;
+
+	// Erase first, so what an erase damages is drawn again below
+	plane_erase();
+	if (shot != drawn_shot) {
+		status_box(STATUS_X_POS, shot_s, &x1, &y1);
+		dirty_erase(STATUS_X_POS, STATUS_Y_POS, x1, y1, CONFIG_COLOR_BACKGROUND);
+		drawn_shot = shot;
+	}
+	if (impacted != drawn_impacted) {
+		status_box(STATUS_X_POS2, impacted_s, &x1, &y1);
+		dirty_erase(STATUS_X_POS2, STATUS_Y_POS, x1, y1, CONFIG_COLOR_BACKGROUND);
+		drawn_impacted = impacted;
 	}
+#endif // CONFIG_ERASE
+	missiles_draw();
+	plane_draw();
+
+	// M3: Draw stats
+	lcd_drawString(STATUS_X_POS, STATUS_Y_POS, shot_s, CONFIG_COLOR_STATUS);
+	lcd_drawString(STATUS_X_POS2, STATUS_Y_POS, impacted_s, CONFIG_COLOR_STATUS);
+#ifdef CONFIG_ERASE
+	status_box(STATUS_X_POS, shot_s, &x1, &y1);
+	dirty_add(STATUS_X_POS, STATUS_Y_POS, x1, y1);
+	status_box(STATUS_X_POS2, impacted_s, &x1, &y1);
+	dirty_add(STATUS_X_POS2, STATUS_Y_POS, x1, y1);
+#endif // CONFIG_ERASE
 }
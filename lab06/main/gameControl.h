@@ -1,14 +1,23 @@
 #ifndef GAMECONTROL_H_
 #define GAMECONTROL_H_
 
+#include <stdint.h>
+
 // Initialize the game control logic.
 // This function initializes all missiles, planes, stats, etc.
-void gameControl_init(void);
+// seed: seed for the random numbers of the game. The same seed and
+// input give the same game.
+void gameControl_init(uint32_t seed);
 
 // Update the game control logic.
-// This function calls the missile & plane tick functions, reinitializes
-// idle enemy missiles, handles button presses, fires player missiles,
-// detects collisions, and updates statistics.
+// This function calls the missile, wave & plane tick functions, handles
+// button presses, fires player missiles, detects collisions, and updates
+// statistics. Nothing is drawn, so the game can be simulated without a
+// display.
 void gameControl_tick(void);
 
+// Draw the game: missiles, plane and statistics. Called once per frame,
+// which may follow more than one call to gameControl_tick().
+void gameControl_draw(void);
+
 #endif // GAMECONTROL_H_
@@ -4,12 +4,15 @@
 #include "freertos/task.h"
 #include "esp_log.h"
 #include "esp_timer.h"
+#include "esp_random.h"
 
 #include "hw.h"
 #include "lcd.h"
 #include "cursor.h"
 #include "sound.h"
-#include "pin.h"
+#include "input.h"
+#include "prof.h"
+#include "dirty.h"
 #include "gameControl.h"
 #include "config.h"
 
@@ -21,20 +24,23 @@
 #define TIME_OUT 500 // ms
 
 #define CURSOR_SZ 7 // Cursor size (width & height) in pixels
+#define CURSOR_R (CURSOR_SZ >> 1) // Cursor half size
+#define MAX_CATCH_UP 4 // Most simulation ticks run before a frame is drawn
 
 static const char *TAG = "lab06";
 
 TimerHandle_t update_timer; // Declare timer handle for update callback
-
-volatile bool interrupt_flag;
+TaskHandle_t game_task; // Task woken by the update timer
 
 uint32_t isr_triggered_count;
 uint32_t isr_handled_count;
+uint32_t frame_count;
 
-// Interrupt handler for game - use flag method
+// Interrupt handler for game - wake the game task. Each call adds one to
+// its notification value, so the task can tell how many ticks are due.
 void update() {
-	interrupt_flag = true;
 	isr_triggered_count++;
+	xTaskNotifyGive(game_task);
 }
 
 // Draw the cursor on the screen
@@ -45,35 +51,97 @@ void cursor(coord_t x, coord_t y, color_t color)
 	lcd_drawVLine(x,    y-s2, CURSOR_SZ, color);
 }
 
+// Start a new game. Random numbers are seeded so that a replayed
+// session spawns the same missiles and planes as the recorded one.
+// seed: seed for random numbers.
+void game_start(uint32_t seed)
+{
+	lcd_fillScreen(CONFIG_COLOR_BACKGROUND);
+#ifdef CONFIG_ERASE
+	dirty_add(0, 0, LCD_W-1, LCD_H-1);
+#endif // CONFIG_ERASE
+	cursor_set_pos(LCD_W/2, LCD_H/2);
+	gameControl_init(seed);
+}
+
+// Run the game loop until the MENU button is pressed or a replay ends.
+// All input is taken through the input layer, once per tick.
+// The task sleeps until the update timer wakes it. The simulation runs
+// at a fixed timestep: every tick that is due is simulated (up to
+// MAX_CATCH_UP, later ones are dropped), then one frame is drawn. If
+// drawing is slow, frames are drawn less often but the game keeps time.
+// Each frame is timed by phase with the frame profiler.
+void game_run(void)
+{
+	coord_t x, y; // For cursor position
+	float dx, dy; // For joystick displacement
+	uint32_t due; // Ticks due
+
+	for (;;) {
+		due = ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+		prof_frame_begin();
+		if (due > MAX_CATCH_UP) due = MAX_CATCH_UP;
+		while (due--) {
+			isr_handled_count++;
+			if (!input_tick() || (input_down() & 1LLU << HW_BTN_MENU)) return;
+			input_get_joy(&dx, &dy);
+			cursor_move(dx, dy);
+			prof_mark(PROF_INPUT);
+			gameControl_tick();
+			prof_mark(PROF_SIMULATE);
+		}
+
+		// Render pass
+		cursor_get_pos(&x, &y);
+#ifdef CONFIG_ERASE
+		// Only changes are drawn, over the last frame. Erase first, so
+		// the game can draw again what the erase damaged.
+		static coord_t lx = -1, ly = -1;
+		if (x != lx || y != ly) {
+			dirty_erase(lx-CURSOR_R, ly-CURSOR_R, lx+CURSOR_R, ly+CURSOR_R, CONFIG_COLOR_BACKGROUND);
+			lx = x; ly = y;
+		}
+#else
+		lcd_fillScreen(CONFIG_COLOR_BACKGROUND);
+#endif // CONFIG_ERASE
+		gameControl_draw();
+		cursor(x, y, CONFIG_COLOR_CURSOR);
+		prof_mark(PROF_RENDER);
+#ifdef CONFIG_ERASE
+		dirty_add(x-CURSOR_R, y-CURSOR_R, x+CURSOR_R, y+CURSOR_R);
+		dirty_flush();
+#else
+		lcd_writeFrame();
+#endif // CONFIG_ERASE
+		prof_mark(PROF_FLUSH);
+		prof_frame_end();
+		frame_count++;
+	}
+}
+
 // Main application
 void app_main(void)
 {
-	// ISR flag and counts
-	interrupt_flag = false;
+	uint32_t seed;
+
+	// ISR counts
 	isr_triggered_count = 0;
 	isr_handled_count = 0;
+	frame_count = 0;
+	game_task = xTaskGetCurrentTaskHandle();
+	prof_init(PER_MS*1000);
 
 	// Initialization
 	lcd_init();
 	lcd_frameEnable();
-	lcd_fillScreen(CONFIG_COLOR_BACKGROUND);
 	cursor_init(PER_MS);
 	sound_init(MISSILELAUNCH_SAMPLE_RATE);
-	gameControl_init();
-
-	// Configure I/O pins for buttons
-	pin_reset(HW_BTN_A);
-	pin_input(HW_BTN_A, true);
-	pin_reset(HW_BTN_B);
-	pin_input(HW_BTN_B, true);
-	pin_reset(HW_BTN_MENU);
-	pin_input(HW_BTN_MENU, true);
-	pin_reset(HW_BTN_OPTION);
-	pin_input(HW_BTN_OPTION, true);
-	pin_reset(HW_BTN_SELECT);
-	pin_input(HW_BTN_SELECT, true);
-	pin_reset(HW_BTN_START);
-	pin_input(HW_BTN_START, true);
+
+	// Configure I/O pins for buttons, joystick and input recording
+	input_init(HW_BTN_MASK);
+	seed = esp_random();
+	input_record(seed);
+	game_start(seed);
 
 	// Initialize update timer
 	update_timer = xTimerCreate(
@@ -92,35 +160,22 @@ void app_main(void)
 		return;
 	}
 
-	// Main game loop
-	uint64_t t1, t2, tmax = 0; // For hardware timer values
-	coord_t x, y; // For cursor position
-	while (pin_get_level(HW_BTN_MENU)) // while MENU button not pressed
-	{
-		while (!interrupt_flag) ;
-		t1 = esp_timer_get_time();
-		interrupt_flag = false;
-		isr_handled_count++;
-
-#ifndef CONFIG_ERASE
-		lcd_fillScreen(CONFIG_COLOR_BACKGROUND);
-#endif // CONFIG_ERASE
-		gameControl_tick();
-		cursor_tick();
-		cursor_get_pos(&x, &y);
-#ifdef CONFIG_ERASE
-		static coord_t lx = -1, ly = -1;
-		if (x != lx || y != ly) {
-			cursor(lx,  ly, CONFIG_COLOR_BACKGROUND);
-			lx = x; ly = y;
-		}
-#endif // CONFIG_ERASE
-		cursor(x, y, CONFIG_COLOR_CURSOR);
-		lcd_writeFrame();
-		t2 = esp_timer_get_time() - t1;
-		if (t2 > tmax) tmax = t2;
+	// Main game loop, until MENU button pressed
+	game_run();
+	printf("Handled %lu of %lu interrupts in %lu frames\n", isr_handled_count, isr_triggered_count, frame_count);
+	prof_print();
+
+	// Hold START while pressing MENU to replay the recorded session with
+	// the same input and random numbers, e.g., to compare tick times.
+	if (input_down() & 1LLU << HW_BTN_START) {
+		const input_frame_t *frames;
+		printf("Replay %lu ticks\n", input_log(&frames));
+		input_replay(NULL, 0);
+		game_start(input_seed());
+		prof_reset();
+		ulTaskNotifyTake(pdTRUE, 0); // Ticks due during the report
+		game_run();
+		prof_print();
 	}
-	printf("Handled %lu of %lu interrupts\n", isr_handled_count, isr_triggered_count);
-	printf("WCET us:%llu\n", tmax);
 	sound_deinit();
 }
@@ -1,17 +1,20 @@
-#include <math.h>
 #include <stdlib.h>
 #include "missile.h"
+#include "collide.h"
+#include "blast.h"
+#include "dirty.h"
 #include "config.h"
 #include "hw.h"
 #include "lcd.h"
 
-#include <stdio.h>
 
-
-// The same missile structure is used for all missiles in the game.
-// All state variables for a missile are contained in the missile structure.
-// There are no global variables maintained in the missile.c file.
-// Each missile function requires a pointer argument to a missile struct.
+// All missiles are kept in one pool, stored as a structure of arrays.
+// Hot fields, used every tick by the batch functions, are separate from
+// the cold fields, only used at launch and when drawing.
+// The single missile functions index the pool with the handle's id.
+// Free entries are kept in a doubly linked list, so that an entry can
+// be taken from it in O(1) both by missile_alloc() and by launching a
+// missile through a handle the caller already has.
 
 typedef enum {
 	initializing,
@@ -22,9 +25,421 @@ typedef enum {
     idle,
 } state_t;
 
+// Q16 fixed point. TO_Q16() is only used on constants, so the conversion
+// from the float configuration values is done by the compiler.
+#define Q16_SHIFT 16
+#define TO_Q16(f) ((int32_t)((f) * (1 << Q16_SHIFT)))
+
+#define PLAYER_SPEED_Q16 TO_Q16(CONFIG_PLAYER_MISSILE_DISTANCE_PER_TICK)
+#define ENEMY_SPEED_Q16 TO_Q16(CONFIG_ENEMY_MISSILE_DISTANCE_PER_TICK)
+#define RADIUS_STEP_Q16 TO_Q16(CONFIG_EXPLOSION_RADIUS_CHANGE_PER_TICK)
+#define RADIUS_MAX_Q16 TO_Q16(CONFIG_EXPLOSION_MAX_RADIUS)
+
+#define NONE UINT16_MAX // End of the free list
+
+#if MISSILE_POOL_MAX >= NONE
+#error "MISSILE_POOL_MAX is too large for the free list"
+#endif
+
+// Pool entry use
+typedef enum {
+    slot_free,  // In the free list
+    slot_taken, // Allocated, not launched
+    slot_live,  // Launched, counted in live[type]
+} slot_t;
+
+// Missile pool
+static uint32_t pool_n; // Missiles in the pool
+static uint8_t slot[MISSILE_POOL_MAX];
+static uint16_t free_prev[MISSILE_POOL_MAX], free_next[MISSILE_POOL_MAX];
+static uint16_t free_head;
+static uint32_t live[MISSILE_TYPE_COUNT]; // Launched missiles by type
+static rng_t *rng; // Random numbers of the game, for launches
+
+// Hot: state, position, velocity and radius
+static uint8_t state[MISSILE_POOL_MAX];
+static bool explode_me[MISSILE_POOL_MAX]; // Detonate while moving
+static int32_t x_q16[MISSILE_POOL_MAX], y_q16[MISSILE_POOL_MAX]; // Position, Q16
+static int32_t vx_q16[MISSILE_POOL_MAX], vy_q16[MISSILE_POOL_MAX]; // Velocity per tick, Q16
+static uint32_t ticks[MISSILE_POOL_MAX]; // Ticks until the destination
+static int32_t radius[MISSILE_POOL_MAX]; // Explosion radius, Q16
+
+// Cold: type, origin and destination
+static uint8_t type[MISSILE_POOL_MAX];
+static coord_t x_origin[MISSILE_POOL_MAX], y_origin[MISSILE_POOL_MAX];
+static coord_t x_dest[MISSILE_POOL_MAX], y_dest[MISSILE_POOL_MAX];
+
+#ifdef CONFIG_ERASE
+// What is on the screen for a missile, for incremental rendering. The
+// trail is drawn as the first n pixels of the path from the origin to
+// the destination, so it can be extended and erased pixel for pixel.
+typedef struct {
+    coord_t xo, yo, xd, yd; // Path of the trail
+    coord_t n;              // Pixels of the trail, zero for none
+    coord_t cx, cy, r;      // Explosion, r < 0 for none
+} drawn_t;
+
+static drawn_t drawn[MISSILE_POOL_MAX];
+static bool launched[MISSILE_POOL_MAX]; // Launched since last drawn
+#endif // CONFIG_ERASE
+
+static const color_t type_color[MISSILE_TYPE_COUNT] = {
+    [MISSILE_TYPE_PLAYER] = CONFIG_COLOR_PLAYER_MISSILE,
+    [MISSILE_TYPE_ENEMY] = CONFIG_COLOR_ENEMY_MISSILE,
+    [MISSILE_TYPE_PLANE] = CONFIG_COLOR_PLANE_MISSILE,
+};
+
 /******************** Helper Functions ********************/
-float pythagorean(coord_t x_dest, coord_t x_origin, coord_t y_dest, coord_t y_origin) {
-    return sqrt(pow(x_dest-x_origin, 2) + pow(y_dest-y_origin, 2));
+
+// Return the integer square root of v, rounded down.
+static uint32_t isqrt64(uint64_t v) {
+    uint64_t r = 0, bit = 1ULL << 62;
+    while (bit > v) bit >>= 2;
+    while (bit) {
+        if (v >= r + bit) {
+            v -= r + bit;
+            r = (r >> 1) + bit;
+        } else {
+            r >>= 1;
+        }
+        bit >>= 2;
+    }
+    return r;
+}
+
+// Take entry i out of the free list, if it is there.
+static void slot_take(uint32_t i) {
+    if (slot[i] != slot_free) return;
+    if (free_prev[i] != NONE) free_next[free_prev[i]] = free_next[i];
+    else free_head = free_next[i];
+    if (free_next[i] != NONE) free_prev[free_next[i]] = free_prev[i];
+    slot[i] = slot_taken;
+}
+
+// Return entry i to the free list as an idle missile.
+static void slot_release(uint32_t i) {
+    state[i] = idle;
+    if (slot[i] == slot_free) return;
+    if (slot[i] == slot_live) live[type[i]]--;
+    free_prev[i] = NONE;
+    free_next[i] = free_head;
+    if (free_head != NONE) free_prev[free_head] = i;
+    free_head = i;
+    slot[i] = slot_free;
+}
+
+// Start a missile in the pool from its origin toward its destination.
+// The fixed-point position, velocity and flight time are computed here,
+// once, with integer math.
+static void missile_launch(uint32_t i, missile_type_t t, coord_t xo, coord_t yo,
+        coord_t xd, coord_t yd) {
+    int32_t speed_q16 = (t == MISSILE_TYPE_PLAYER) ? PLAYER_SPEED_Q16 : ENEMY_SPEED_Q16;
+    int32_t dx = xd - xo;
+    int32_t dy = yd - yo;
+    // Length of the flight path in Q16
+    int64_t len_q16 = isqrt64(((uint64_t)(dx*dx + dy*dy)) << (2*Q16_SHIFT));
+
+    slot_take(i);
+    if (slot[i] == slot_live) live[type[i]]--;
+    slot[i] = slot_live;
+    live[t]++;
+    type[i] = t;
+    state[i] = initializing;
+    explode_me[i] = false;
+    radius[i] = 0;
+    x_origin[i] = xo;
+    y_origin[i] = yo;
+    x_dest[i] = xd;
+    y_dest[i] = yd;
+#ifdef CONFIG_ERASE
+    launched[i] = true;
+#endif // CONFIG_ERASE
+    x_q16[i] = xo * (1 << Q16_SHIFT);
+    y_q16[i] = yo * (1 << Q16_SHIFT);
+    if (len_q16 == 0) {
+        vx_q16[i] = vy_q16[i] = 0;
+        ticks[i] = 1;
+        return;
+    }
+    vx_q16[i] = (int64_t)dx * speed_q16 * (1 << Q16_SHIFT) / len_q16;
+    vy_q16[i] = (int64_t)dy * speed_q16 * (1 << Q16_SHIFT) / len_q16;
+    ticks[i] = (len_q16 + speed_q16 - 1) / speed_q16;
+}
+
+// State transitions of missile i. A missile that becomes idle is
+// returned to the free list.
+// Return true if the missile just impacted.
+static inline bool missile_transition(uint32_t i) {
+    switch (state[i]) {
+        case initializing:
+            state[i] = moving;
+            break;
+        case moving:
+            if (explode_me[i]) {
+                state[i] = exploding_growing;
+            } else if ((type[i] != MISSILE_TYPE_PLAYER) && (ticks[i] == 0)) {
+                state[i] = impacted;
+                return true;
+            }
+            break;
+        case exploding_growing:
+            if (radius[i] >= RADIUS_MAX_Q16) {
+                state[i] = exploding_shrinking;
+            }
+            break;
+        case exploding_shrinking:
+            if (radius[i] <= 0) {
+                slot_release(i);
+            }
+            break;
+        case impacted:
+            slot_release(i);
+            break;
+        case idle:
+            break;
+    }
+    return false;
+}
+
+// Move missile i one tick, if it is moving.
+static inline void missile_advance(uint32_t i) {
+    if (ticks[i] > 0) {
+        ticks[i]--;
+        x_q16[i] += vx_q16[i];
+        y_q16[i] += vy_q16[i];
+    }
+    // player missile explosion upon arrival
+    if (type[i] == MISSILE_TYPE_PLAYER && ticks[i] == 0) {
+        explode_me[i] = true;
+    }
+}
+
+// Grow or shrink the radius of missile i one tick, if it is exploding.
+static inline void missile_explode_step(uint32_t i) {
+    if (state[i] == exploding_growing) {
+        radius[i] += RADIUS_STEP_Q16;
+    } else if (state[i] == exploding_shrinking) {
+        radius[i] -= RADIUS_STEP_Q16;
+    }
+}
+
+#ifdef CONFIG_ERASE
+// Get pixel k of the path from (xo,yo) to (xd,yd). Pixels are counted
+// along the major axis from zero at the origin, and the minor axis is
+// rounded to nearest, so pixel k is the same whatever pixels are drawn.
+static inline void path_pixel(const drawn_t *d, coord_t k, coord_t *x, coord_t *y) {
+    int32_t dx = d->xd - d->xo, dy = d->yd - d->yo;
+    int32_t ax = abs(dx), ay = abs(dy);
+    if (ax >= ay) {
+        *x = d->xo + ((dx < 0) ? -k : k);
+        *y = d->yo + (ax ? ((dy < 0) ? -1 : 1) * ((2*k*ay + ax) / (2*ax)) : 0);
+    } else {
+        *y = d->yo + ((dy < 0) ? -k : k);
+        *x = d->xo + ((dx < 0) ? -1 : 1) * ((2*k*ax + ay) / (2*ay));
+    }
+}
+
+// Draw pixels k0 to k1-1 of a path and mark them changed. A path erased
+// to the background is also marked damaged, so the trails it crossed
+// are drawn again (see path_repair()).
+static void path_draw(const drawn_t *d, coord_t k0, coord_t k1, color_t color) {
+    coord_t x, y, x0, y0, x1, y1;
+    if (k0 >= k1) return;
+    for (coord_t k = k0; k < k1; k++) {
+        path_pixel(d, k, &x, &y);
+        lcd_drawPixel(x, y, color);
+    }
+    path_pixel(d, k0, &x0, &y0);
+    path_pixel(d, k1-1, &x1, &y1);
+    if (x1 < x0) { x = x0; x0 = x1; x1 = x; }
+    if (y1 < y0) { y = y0; y0 = y1; y1 = y; }
+    if (color == CONFIG_COLOR_BACKGROUND) dirty_damage(x0, y0, x1, y1);
+    else dirty_add(x0, y0, x1, y1);
+}
+
+// Draw again the pixels of a trail that were erased by something else.
+// They are already marked changed by the erase.
+static void path_repair(const drawn_t *d, color_t color) {
+    coord_t x, y, x1, y1;
+    path_pixel(d, 0, &x, &y);
+    path_pixel(d, d->n-1, &x1, &y1);
+    if (!dirty_hit((x < x1) ? x : x1, (y < y1) ? y : y1,
+            (x < x1) ? x1 : x, (y < y1) ? y1 : y)) return;
+    for (coord_t k = 0; k < d->n; k++) {
+        path_pixel(d, k, &x, &y);
+        if (dirty_hit(x, y, x, y)) lcd_drawPixel(x, y, color);
+    }
+}
+
+// Draw the missiles incrementally: erase what is gone, extend the trails
+// of moving missiles by the pixels moved since the last frame (and draw
+// again what was erased of them), and draw the explosions.
+static void missiles_draw_changes(void) {
+    // Erase trails and explosions that are gone or shrank
+    for (uint32_t i = 0; i < pool_n; i++) {
+        drawn_t *d = drawn+i;
+        bool boom = !launched[i] && (state[i] == exploding_growing || state[i] == exploding_shrinking);
+        if (d->n && (state[i] != moving || launched[i])) {
+            path_draw(d, 0, d->n, CONFIG_COLOR_BACKGROUND);
+            d->n = 0;
+        }
+        if (d->r >= 0 && (!boom || (radius[i] >> Q16_SHIFT) < d->r)) {
+            dirty_erase(d->cx - d->r, d->cy - d->r, d->cx + d->r, d->cy + d->r,
+                CONFIG_COLOR_BACKGROUND);
+            d->r = -1;
+        }
+        launched[i] = false;
+    }
+    // Trails, by color
+    for (uint32_t t = 0; t < MISSILE_TYPE_COUNT; t++) {
+        for (uint32_t i = 0; i < pool_n; i++) {
+            if (type[i] != t || state[i] != moving) continue;
+            drawn_t *d = drawn+i;
+            if (d->n) path_repair(d, type_color[t]);
+            if (d->n == 0) {
+                d->xo = x_origin[i]; d->yo = y_origin[i];
+                d->xd = x_dest[i]; d->yd = y_dest[i];
+            }
+            // Pixels up to the current position along the major axis
+            coord_t ax = abs(d->xd - d->xo), ay = abs(d->yd - d->yo);
+            coord_t k = (ax >= ay) ?
+                abs((x_q16[i] >> Q16_SHIFT) - d->xo) : abs((y_q16[i] >> Q16_SHIFT) - d->yo);
+            if (k > ((ax >= ay) ? ax : ay)) k = (ax >= ay) ? ax : ay;
+            path_draw(d, d->n, k+1, type_color[t]);
+            if (k+1 > d->n) d->n = k+1;
+        }
+    }
+    // Explosions, by color
+    for (uint32_t t = 0; t < MISSILE_TYPE_COUNT; t++) {
+        for (uint32_t i = 0; i < pool_n; i++) {
+            if (type[i] != t || (state[i] != exploding_growing && state[i] != exploding_shrinking)) continue;
+            drawn_t *d = drawn+i;
+            d->cx = x_q16[i] >> Q16_SHIFT;
+            d->cy = y_q16[i] >> Q16_SHIFT;
+            d->r = radius[i] >> Q16_SHIFT;
+            blast_draw(d->cx, d->cy, d->r, type_color[t]);
+            dirty_add(d->cx - d->r, d->cy - d->r, d->cx + d->r, d->cy + d->r);
+        }
+    }
+}
+#endif // CONFIG_ERASE
+
+/******************** Missile Pool Functions ********************/
+
+// Initialize the pool with n idle missiles, all free, and the explosion
+// spans (see blast_init()). Must be called before any other missile
+// function.
+// n: number of missiles, up to MISSILE_POOL_MAX.
+// *r: random number generator used for launches, kept by reference.
+// Return zero if successful, or non-zero otherwise.
+int32_t missiles_init(uint32_t n, rng_t *r) {
+    if (n > MISSILE_POOL_MAX) return -1;
+    pool_n = n;
+    rng = r;
+    blast_init();
+    free_head = NONE;
+    for (uint32_t t = 0; t < MISSILE_TYPE_COUNT; t++) live[t] = 0;
+    for (uint32_t i = n; i-- > 0; ) { // Free list in pool order
+        slot[i] = slot_taken;
+        slot_release(i);
+#ifdef CONFIG_ERASE
+        drawn[i] = (drawn_t){.n = 0, .r = -1};
+        launched[i] = false;
+#endif // CONFIG_ERASE
+    }
+    return 0;
+}
+
+// Allocate an idle missile from the pool, in O(1). It is returned to
+// the pool when it becomes idle again after launch, or by
+// missile_init_idle().
+// *missile: set to the handle of the missile.
+// Return true if successful, or false if no missile is free.
+bool missile_alloc(missile_t *missile) {
+    if (free_head == NONE) return false;
+    missile->id = free_head;
+    slot_take(free_head);
+    return true;
+}
+
+// Return the number of launched missiles of a type that are not yet
+// idle again.
+uint32_t missiles_count(missile_type_t t) {
+    return live[t];
+}
+
+// Tick all missiles in the pool: state transitions, then
+// missiles_advance() and missiles_explode_step().
+// Return the number of enemy and plane missiles that impacted.
+uint32_t missiles_tick(void) {
+    uint32_t n = 0;
+    for (uint32_t i = 0; i < pool_n; i++)
+        n += missile_transition(i);
+    missiles_advance();
+    missiles_explode_step();
+    return n;
+}
+
+// Move all moving missiles one tick along their path. A player missile
+// that arrives is detonated.
+void missiles_advance(void) {
+    for (uint32_t i = 0; i < pool_n; i++)
+        if (state[i] == moving) missile_advance(i);
+}
+
+// Grow or shrink the radius of all exploding missiles by one tick.
+void missiles_explode_step(void) {
+    for (uint32_t i = 0; i < pool_n; i++)
+        missile_explode_step(i);
+}
+
+// Bin the exploding missiles for collide_hit() and detonate the moving
+// enemy and plane missiles that are inside an explosion. Call after
+// missiles_tick() in each tick.
+// Return the number of missiles detonated.
+uint32_t missiles_collide(void) {
+    uint32_t n = 0;
+
+    collide_clear();
+    for (uint32_t i = 0; i < pool_n; i++) {
+        if (state[i] == exploding_growing || state[i] == exploding_shrinking) {
+            missile_t m = {i};
+            collide_add(x_q16[i] >> Q16_SHIFT, y_q16[i] >> Q16_SHIFT, missile_radius(&m));
+        }
+    }
+    for (uint32_t i = 0; i < pool_n; i++) {
+        if (state[i] == moving && type[i] != MISSILE_TYPE_PLAYER && !explode_me[i] &&
+                collide_hit(x_q16[i] >> Q16_SHIFT, y_q16[i] >> Q16_SHIFT)) {
+            explode_me[i] = true;
+            n++;
+        }
+    }
+    return n;
+}
+
+// Draw all missiles, batched by primitive and then by color: the lines
+// from the origin of the moving missiles, then the filled circles of the
+// exploding missiles on top. With CONFIG_ERASE, only the changes since
+// the last call are drawn, on a frame that is not cleared.
+void missiles_draw(void) {
+#ifdef CONFIG_ERASE
+    missiles_draw_changes();
+#else
+    for (uint32_t t = 0; t < MISSILE_TYPE_COUNT; t++) {
+        for (uint32_t i = 0; i < pool_n; i++) {
+            if (type[i] != t || state[i] != moving) continue;
+            lcd_drawLine(x_origin[i], y_origin[i],
+                x_q16[i] >> Q16_SHIFT, y_q16[i] >> Q16_SHIFT, type_color[t]);
+        }
+    }
+    for (uint32_t t = 0; t < MISSILE_TYPE_COUNT; t++) {
+        for (uint32_t i = 0; i < pool_n; i++) {
+            if (type[i] != t || (state[i] != exploding_growing && state[i] != exploding_shrinking)) continue;
+            blast_draw(x_q16[i] >> Q16_SHIFT, y_q16[i] >> Q16_SHIFT,
+                radius[i] >> Q16_SHIFT, type_color[t]);
+        }
+    }
+#endif // CONFIG_ERASE
 }
 
 /******************** Missile Init Functions ********************/
@@ -32,9 +447,10 @@ float pythagorean(coord_t x_dest, coord_t x_origin, coord_t y_dest, coord_t y_or
 // Different _init_ functions are used depending on the missile type.
 
 // Initialize the missile as an idle missile. If initialized to the idle
-// state, a missile doesn't appear nor does it move.
+// state, a missile doesn't appear nor does it move. It is returned to the
+// pool.
 void missile_init_idle(missile_t *missile) {
-    missile->currentState = idle;
+    slot_release(missile->id);
 }
 
 // Initialize the missile as a player missile. This function takes an (x, y)
@@ -42,60 +458,33 @@ void missile_init_idle(missile_t *missile) {
 // closest "firing location" to the destination (there are three firing
 // locations evenly spaced along the bottom of the screen).
 void missile_init_player(missile_t *missile, coord_t x_dest, coord_t y_dest) {
-    missile->type = MISSILE_TYPE_PLAYER;
-    missile->currentState = initializing;
+    coord_t xo;
     if (x_dest < 3*HW_LCD_W/8) {
-        missile->x_origin = HW_LCD_W/4;
+        xo = HW_LCD_W/4;
     } else if (x_dest < 5*HW_LCD_W/8) {
-        missile->x_origin = HW_LCD_W/2;
+        xo = HW_LCD_W/2;
     } else {
-        missile->x_origin = 3*HW_LCD_W/4;
+        xo = 3*HW_LCD_W/4;
     }
-    missile->y_origin = HW_LCD_H;
-    missile->x_dest = x_dest;
-    missile->y_dest = y_dest;
-    missile->total_length = pythagorean(x_dest, missile->x_origin, y_dest, missile->y_origin);
-    missile->x_current = missile->x_origin;
-    missile->y_current = missile->y_origin;
-    missile->length = 0;
-    missile->explode_me = false;
-    missile->radius = 0;
+    missile_launch(missile->id, MISSILE_TYPE_PLAYER, xo, HW_LCD_H, x_dest, y_dest);
 }
 
 // Initialize the missile as an enemy missile. This will randomly choose the
 // origin and destination of the missile. The origin is somewhere near the
 // top of the screen, and the destination is the very bottom of the screen.
 void missile_init_enemy(missile_t *missile) {
-    missile->type = MISSILE_TYPE_ENEMY;
-    missile->currentState = initializing;
-    missile->x_origin = rand() % HW_LCD_W; 
-    missile->y_origin = rand() % (HW_LCD_H/8);
-    missile->x_dest = rand() % HW_LCD_W;
-    missile->y_dest = HW_LCD_H;
-    missile->total_length = pythagorean(missile->x_dest, missile->x_origin, missile->y_dest, missile->y_origin);
-    missile->x_current = missile->x_origin;
-    missile->y_current = missile->y_origin;
-    missile->length = 0;
-    missile->explode_me = false;
-    missile->radius = 0;
+    coord_t xo = rng_below(rng, HW_LCD_W);
+    coord_t yo = rng_below(rng, HW_LCD_H/8);
+    coord_t xd = rng_below(rng, HW_LCD_W);
+    missile_launch(missile->id, MISSILE_TYPE_ENEMY, xo, yo, xd, HW_LCD_H);
 }
 
 // Initialize the missile as a plane missile. This function takes the (x, y)
 // location of the plane as an argument and uses it as the missile origin.
 // The destination is randomly chosen along the bottom of the screen.
 void missile_init_plane(missile_t *missile, coord_t x_orig, coord_t y_orig) {
-    missile->type = MISSILE_TYPE_PLANE;
-    missile->currentState = initializing;
-    missile->x_origin = x_orig; 
-    missile->y_origin = y_orig;
-    missile->x_dest = rand() % HW_LCD_W;
-    missile->y_dest = HW_LCD_H;
-    missile->total_length = pythagorean(missile->x_dest, missile->x_origin, missile->y_dest, missile->y_origin);
-    missile->x_current = missile->x_origin;
-    missile->y_current = missile->y_origin;
-    missile->length = 0;
-    missile->explode_me = false;
-    missile->radius = 0;
+    coord_t xd = rng_below(rng, HW_LCD_W);
+    missile_launch(missile->id, MISSILE_TYPE_PLANE, x_orig, y_orig, xd, HW_LCD_H);
 }
 
 /******************** Missile Control & Tick Functions ********************/
@@ -103,132 +492,57 @@ void missile_init_plane(missile_t *missile, coord_t x_orig, coord_t y_orig) {
 // Used to indicate that a moving missile should be detonated. This occurs
 // when an enemy or a plane missile is located within an explosion zone.
 void missile_explode(missile_t *missile) {
-    missile->explode_me = true;
+    explode_me[missile->id] = true;
 }
 
-// Tick the state machine for a single missile.
+// Tick the state machine for a single missile. The batch function
+// missiles_tick() does the same for the whole pool.
 void missile_tick(missile_t *missile) {
-
-    // state transitions
-    switch (missile->currentState) {
-        case initializing:
-            missile->currentState = moving;
-            break;
-        case moving:
-            if (missile->explode_me) {
-                missile->currentState = exploding_growing;
-            } else if ((missile->type != MISSILE_TYPE_PLAYER) && (missile->length >= missile->total_length)) {
-                missile->currentState = impacted;
-            }
-            break;
-        case exploding_growing:
-            if (missile->radius >= CONFIG_EXPLOSION_MAX_RADIUS) {
-                missile->currentState = exploding_shrinking;
-            }
-            break;
-        case exploding_shrinking:
-            if (missile->radius <= 0) {
-                missile->currentState = idle;
-            }
-            break;
-        case impacted:
-            missile->currentState = idle;
-            break;
-        case idle:
-            break;
-    }
-
-    // state actions
-    color_t color;
-    switch (missile->currentState) {
-        case initializing:
-            break;
-        case moving:
-            float missile_distance_per_tick;
-
-            if (missile->type == MISSILE_TYPE_PLAYER) {
-                missile_distance_per_tick = CONFIG_PLAYER_MISSILE_DISTANCE_PER_TICK;
-                color = CONFIG_COLOR_PLAYER_MISSILE;
-            } else if (missile->type == MISSILE_TYPE_ENEMY) {
-                missile_distance_per_tick = CONFIG_ENEMY_MISSILE_DISTANCE_PER_TICK;
-                color = CONFIG_COLOR_ENEMY_MISSILE;
-            } else {
-                missile_distance_per_tick = CONFIG_ENEMY_MISSILE_DISTANCE_PER_TICK;
-                color = CONFIG_COLOR_PLANE_MISSILE;
-            }
-
-            missile->length += missile_distance_per_tick;
-            float fraction = missile->length / missile->total_length;
-            missile->x_current = missile->x_origin + fraction * (missile->x_dest - missile->x_origin);
-            missile->y_current = missile->y_origin + fraction * (missile->y_dest - missile->y_origin);
-            lcd_drawLine(missile->x_origin, missile->y_origin, missile->x_current, missile->y_current, color);
-
-            // player missile explosion upon arrival
-            if (missile->type == MISSILE_TYPE_PLAYER && missile->length >= missile->total_length) {
-                missile_explode(missile);
-            }
-            break;
-        case exploding_growing:
-            if (missile->type == MISSILE_TYPE_PLAYER) {
-                color = CONFIG_COLOR_PLAYER_MISSILE;
-            } else if (missile->type == MISSILE_TYPE_ENEMY) {
-                color = CONFIG_COLOR_ENEMY_MISSILE;
-            } else {
-                color = CONFIG_COLOR_PLANE_MISSILE;
-            }
-            missile->radius += CONFIG_EXPLOSION_RADIUS_CHANGE_PER_TICK;
-            lcd_fillCircle(missile->x_current, missile->y_current, missile->radius, color);
-            break;
-        case exploding_shrinking:
-            if (missile->type == MISSILE_TYPE_PLAYER) {
-                color = CONFIG_COLOR_PLAYER_MISSILE;
-            } else if (missile->type == MISSILE_TYPE_ENEMY) {
-                color = CONFIG_COLOR_ENEMY_MISSILE;
-            } else {
-                color = CONFIG_COLOR_PLANE_MISSILE;
-            }
-            missile->radius -= CONFIG_EXPLOSION_RADIUS_CHANGE_PER_TICK;
-            lcd_fillCircle(missile->x_current, missile->y_current, missile->radius, color);
-            break;
-        case impacted:
-            break;
-        case idle:
-            break;
-    }
+    uint32_t i = missile->id;
+    missile_transition(i);
+    if (state[i] == moving) missile_advance(i);
+    missile_explode_step(i);
 }
 
 /******************** Missile Status Functions ********************/
 
 // Return the current missile position through the pointers *x,*y.
 void missile_get_pos(missile_t *missile, coord_t *x, coord_t *y) {
-    *x = missile->x_current;
-    *y = missile->y_current;
+    *x = x_q16[missile->id] >> Q16_SHIFT;
+    *y = y_q16[missile->id] >> Q16_SHIFT;
 }
 
 // Return the missile type.
 missile_type_t missile_get_type(missile_t *missile) {
-    return missile->type;
+    return type[missile->id];
 }
 
 // Return whether the given missile is moving.
 bool missile_is_moving(missile_t *missile) {
-    return missile->currentState == moving;
+    return state[missile->id] == moving;
 }
 
 // Return whether the given missile is exploding. If this missile
 // is exploding, it can explode another intersecting missile.
 bool missile_is_exploding(missile_t *missile) {
-    return (missile->currentState == exploding_growing || missile->currentState == exploding_shrinking);
+    return (state[missile->id] == exploding_growing || state[missile->id] == exploding_shrinking);
 }
 
 // Return whether the given missile is idle.
 bool missile_is_idle(missile_t *missile) {
-    return missile->currentState == idle;
+    return state[missile->id] == idle;
 }
 
 // Return whether the given missile is impacted.
 bool missile_is_impacted(missile_t *missile) {
-    return missile->currentState == impacted;
+    return state[missile->id] == impacted;
+}
+
+// Return the explosion radius in whole pixels (as drawn), or a negative
+// value if none.
+coord_t missile_radius(missile_t *missile) {
+    if (!missile_is_exploding(missile)) return -1;
+    return radius[missile->id] >> Q16_SHIFT;
 }
 
 // Return whether an object (e.g., missile or plane) at the specified
@@ -236,5 +550,8 @@ bool missile_is_impacted(missile_t *missile) {
 // to occur, the missile needs to be exploding and the specified
 // position needs to be within the explosion radius.
 bool missile_is_colliding(missile_t *missile, coord_t x, coord_t y) {
-    return pythagorean(x, missile->x_current, y, missile->y_current) <= missile->radius;
-}
\ No newline at end of file
+    coord_t mx, my;
+    if (!missile_is_exploding(missile)) return false;
+    missile_get_pos(missile, &mx, &my);
+    return blast_hit(x - mx, y - my, missile_radius(missile));
+}
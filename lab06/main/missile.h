@@ -5,58 +5,88 @@
 #include <stdint.h>
 
 #include "lcd.h" // coord_t
-
-// The same missile structure is used for all missiles in the game.
-// All state variables for a missile are contained in the missile structure.
-// There are no global variables maintained in the missile.c file.
-// Each missile function requires a pointer argument to a missile struct.
+#include "rng.h"
+#include "config.h"
+
+// All missiles are kept in one pool, stored as a structure of arrays:
+// each field of all missiles is in its own array, so the batch functions
+// (missiles_*) only touch the fields they need, in tight loops over the
+// pool. A missile_t is a handle to one missile in the pool, used by the
+// single missile functions (missile_*) that make up the original API.
+// Handles are taken from the pool with missile_alloc(), and a missile
+// goes back to the pool by itself when it is idle again.
+
+// Number of missiles the pool can hold. May be raised (e.g., for a
+// benchmark) by defining it on the command line.
+#ifndef MISSILE_POOL_MAX
+#define MISSILE_POOL_MAX CONFIG_MAX_TOTAL_MISSILES
+#endif
 
 // This enum is used to identify the type of missile.
 typedef enum {
 	MISSILE_TYPE_PLAYER,
 	MISSILE_TYPE_ENEMY,
-	MISSILE_TYPE_PLANE
+	MISSILE_TYPE_PLANE,
+	MISSILE_TYPE_COUNT
 } missile_type_t;
 
-// This struct contains all information about a missile.
+// Handle to a missile in the pool, see missile_alloc().
 typedef struct {
-
-	// Missile type (player, enemy, enemy plane).
-	missile_type_t type;
-
-	// Current state. The 'enum' is defined in your missile.c file.
-	int32_t currentState;
-
-	// Origin & destination x,y of missile.
-	coord_t x_origin;
-	coord_t y_origin;
-	coord_t x_dest;
-	coord_t y_dest;
-
-	// The total length of the flight path from origin to destination x,y.
-	float total_length;
-
-	// Tracks the current x,y of missile.
-	coord_t x_current;
-	coord_t y_current;
-
-	// The current length of the flight path from origin to current x,y.
-	float length;
-
-	// A flag to indicate the missile should be detonated when moving.
-	bool explode_me;
-
-	// While exploding, this tracks the current radius.
-	float radius;
-
+	uint16_t id; // Index into the pool arrays
 } missile_t;
 
+/******************** Missile Pool Functions ********************/
+
+// Initialize the pool with n idle missiles, all free, and the explosion
+// spans (see blast_init()). Must be called before any other missile
+// function.
+// n: number of missiles, up to MISSILE_POOL_MAX.
+// *r: random number generator used for launches, kept by reference.
+// Return zero if successful, or non-zero otherwise.
+int32_t missiles_init(uint32_t n, rng_t *r);
+
+// Allocate an idle missile from the pool, in O(1). It is returned to
+// the pool when it becomes idle again after launch, or by
+// missile_init_idle().
+// *missile: set to the handle of the missile.
+// Return true if successful, or false if no missile is free.
+bool missile_alloc(missile_t *missile);
+
+// Return the number of launched missiles of a type that are not yet
+// idle again.
+uint32_t missiles_count(missile_type_t t);
+
+// Tick all missiles in the pool: state transitions, then
+// missiles_advance() and missiles_explode_step().
+// Return the number of enemy and plane missiles that impacted.
+uint32_t missiles_tick(void);
+
+// Move all moving missiles one tick along their path. A player missile
+// that arrives is detonated.
+void missiles_advance(void);
+
+// Grow or shrink the radius of all exploding missiles by one tick.
+void missiles_explode_step(void);
+
+// Bin the exploding missiles for collide_hit() and detonate the moving
+// enemy and plane missiles that are inside an explosion. Call after
+// missiles_tick() in each tick.
+// Return the number of missiles detonated.
+uint32_t missiles_collide(void);
+
+// Draw all missiles, batched by primitive and then by color: the lines
+// from the origin of the moving missiles, then the filled circles of the
+// exploding missiles on top. With CONFIG_ERASE, only the changes since
+// the last call are drawn, on a frame that is not cleared.
+void missiles_draw(void);
+
 /******************** Missile Init Functions ********************/
 
 // Different _init_ functions are used depending on the missile type.
 
 // Initialize the missile as an idle missile. If initialized to the idle
-// state, a missile doesn't appear nor does it move.
+// state, a missile doesn't appear nor does it move. It is returned to the
+// pool.
 void missile_init_idle(missile_t *missile);
 
 // Initialize the missile as a player missile. This function takes an (x, y)
@@ -81,7 +111,8 @@ void missile_init_plane(missile_t *missile, coord_t x_orig, coord_t y_orig);
 // when an enemy or a plane missile is located within an explosion zone.
 void missile_explode(missile_t *missile);
 
-// Tick the state machine for a single missile.
+// Tick the state machine for a single missile. The batch function
+// missiles_tick() does the same for the whole pool.
 void missile_tick(missile_t *missile);
 
 /******************** Missile Status Functions ********************/
@@ -105,6 +136,10 @@ bool missile_is_idle(missile_t *missile);
 // Return whether the given missile is impacted.
 bool missile_is_impacted(missile_t *missile);
 
+// Return the explosion radius in whole pixels (as drawn), or a negative
+// value if none.
+coord_t missile_radius(missile_t *missile);
+
 // Return whether an object (e.g., missile or plane) at the specified
 // (x,y) position is colliding with the given missile. For a collision
 // to occur, the missile needs to be exploding and the specified
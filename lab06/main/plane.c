@@ -1,6 +1,7 @@
 #include "plane.h"
 #include "lcd.h"
 #include "config.h"
+#include "dirty.h"
 #include <stdio.h>
 #include <math.h>
 
@@ -16,46 +17,56 @@ typedef enum {
 plane_t plane;
 uint32_t launch_loc;
 uint8_t shots;
+rng_t *plane_rng; // Random numbers of the game
+
+#ifdef CONFIG_ERASE
+// Position of the plane on the screen, drawn_x is NONE if not drawn
+#define NONE INT32_MIN
+coord_t drawn_x = NONE;
+#endif // CONFIG_ERASE
 
 /******************** Plane Init Function ********************/
 
-// Initialize the plane state machine. Pass a pointer to the missile
-// that will be (re)launched by the plane. It will only have one missile.
-void plane_init(missile_t *plane_missile) {
+// Initialize the plane state machine. The plane is idle until
+// plane_launch(). Its missiles are taken from the missile pool.
+// *r: random number generator for the launch point, kept by reference.
+void plane_init(rng_t *r) {
     plane.currentState = idle;
-    plane.timeout = CONFIG_PLANE_IDLE_TIME_TICKS;
-    plane.missile = plane_missile;
-    launch_loc = rand() % HW_LCD_W;
-    shots = 1;
+    plane_rng = r;
+#ifdef CONFIG_ERASE
+    drawn_x = NONE;
+#endif // CONFIG_ERASE
 }
 
 /******************** Plane Control & Tick Functions ********************/
 
+// Start a flight of the plane from the right edge of the screen, if it
+// is idle. It fires one missile at a random point of the flight.
+void plane_launch(void) {
+    if (plane.currentState != idle) return;
+    plane.currentState = moving;
+    plane.x_position = HW_LCD_W;
+    launch_loc = rng_below(plane_rng, HW_LCD_W);
+    shots = 1;
+}
+
 // Trigger the plane to explode.
 void plane_explode(void) {
     plane.currentState = idle;
-    plane.timeout = CONFIG_PLANE_IDLE_TIME_TICKS;
-    launch_loc = rand() % HW_LCD_W;
-    shots = 1;
 }
 
 // State machine tick function.
 void plane_tick(void) {
 
+    missile_t missile;
+
     // state transitions
     switch(plane.currentState) {
         case idle:
-            if (plane.timeout < 0) {
-                plane.currentState = moving;
-                plane.x_position = HW_LCD_W;
-            }
             break;
         case moving:
             if (plane.x_position < -CONFIG_PLANE_WIDTH) {
                 plane.currentState = idle;
-                plane.timeout = CONFIG_PLANE_IDLE_TIME_TICKS;
-                launch_loc = rand() % HW_LCD_W;
-                shots = 1;
             }
             break;
     }
@@ -63,22 +74,46 @@ void plane_tick(void) {
     // state actions
     switch(plane.currentState) {
         case idle:
-            plane.timeout -= 1;
             break;
         case moving:
             plane.x_position -= CONFIG_PLANE_DISTANCE_PER_TICK;
-            lcd_fillTriangle(plane.x_position, PLANE_Y_POS,
-                (plane.x_position + CONFIG_PLANE_WIDTH), (PLANE_Y_POS - CONFIG_PLANE_HEIGHT/2),
-                (plane.x_position + CONFIG_PLANE_WIDTH), (PLANE_Y_POS + CONFIG_PLANE_HEIGHT/2),
-                CONFIG_COLOR_PLANE);
-            
-            if (plane.x_position < launch_loc && missile_is_idle(plane.missile) && shots > 0) {
-                missile_init_plane(plane.missile, plane.x_position, PLANE_Y_POS);
+            if (plane.x_position < launch_loc && shots > 0 &&
+                missiles_count(MISSILE_TYPE_PLANE) < CONFIG_MAX_PLANE_MISSILES &&
+                missile_alloc(&missile)) {
+                missile_init_plane(&missile, plane.x_position, PLANE_Y_POS);
                 shots--;
             }
             break;
     }
 }
+
+#ifdef CONFIG_ERASE
+// Erase the plane from the screen if it moved or is gone. Call before
+// drawing anything else in a frame, see dirty_hit().
+void plane_erase(void) {
+    if (drawn_x == NONE) return;
+    if (plane.currentState == moving && plane.x_position == drawn_x) return;
+    dirty_erase(drawn_x, PLANE_Y_POS - CONFIG_PLANE_HEIGHT/2,
+        drawn_x + CONFIG_PLANE_WIDTH, PLANE_Y_POS + CONFIG_PLANE_HEIGHT/2,
+        CONFIG_COLOR_BACKGROUND);
+    drawn_x = NONE;
+}
+#endif // CONFIG_ERASE
+
+// Draw the plane if it is flying.
+void plane_draw(void) {
+    if (plane.currentState != moving) return;
+    lcd_fillTriangle(plane.x_position, PLANE_Y_POS,
+        (plane.x_position + CONFIG_PLANE_WIDTH), (PLANE_Y_POS - CONFIG_PLANE_HEIGHT/2),
+        (plane.x_position + CONFIG_PLANE_WIDTH), (PLANE_Y_POS + CONFIG_PLANE_HEIGHT/2),
+        CONFIG_COLOR_PLANE);
+#ifdef CONFIG_ERASE
+    dirty_add(plane.x_position, PLANE_Y_POS - CONFIG_PLANE_HEIGHT/2,
+        plane.x_position + CONFIG_PLANE_WIDTH, PLANE_Y_POS + CONFIG_PLANE_HEIGHT/2);
+    drawn_x = plane.x_position;
+#endif // CONFIG_ERASE
+}
+
 /******************** Plane Status Function ********************/
 
 // Return the current plane position through the pointers *x,*y.
@@ -5,12 +5,8 @@
 
 // Plane
 typedef struct {
-	// state and idle timeout
+	// state
     int32_t currentState;
-    float timeout;
-
-	// plane's missile
-    missile_t* missile;
 
 	// plane position
 	coord_t x_position;
@@ -19,18 +15,32 @@ typedef struct {
 
 /******************** Plane Init Function ********************/
 
-// Initialize the plane state machine. Pass a pointer to the missile
-// that will be (re)launched by the plane. It will only have one missile.
-void plane_init(missile_t *plane_missile);
+// Initialize the plane state machine. The plane is idle until
+// plane_launch(). Its missiles are taken from the missile pool.
+// *r: random number generator for the launch point, kept by reference.
+void plane_init(rng_t *r);
 
 /******************** Plane Control & Tick Functions ********************/
 
+// Start a flight of the plane from the right edge of the screen, if it
+// is idle. It fires one missile at a random point of the flight. Called
+// by the wave scheduler, see wave.h.
+void plane_launch(void);
+
 // Trigger the plane to explode.
 void plane_explode(void);
 
-// State machine tick function.
+// State machine tick function. Only updates state, see plane_draw().
 void plane_tick(void);
 
+// Erase the plane from the screen if it moved or is gone. Call before
+// drawing anything else in a frame, see dirty_hit(). Only used with
+// CONFIG_ERASE, when the frame is not cleared.
+void plane_erase(void);
+
+// Draw the plane if it is flying.
+void plane_draw(void);
+
 /******************** Plane Status Function ********************/
 
 // Return the current plane position through the pointers *x,*y.
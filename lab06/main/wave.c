@@ -0,0 +1,62 @@
+#include "missile.h"
+#include "plane.h"
+#include "wave.h"
+
+static const wave_t *wave; // Current wave
+static const wave_t *wave_last;
+static uint32_t wave_idx;
+static uint32_t wave_ticks; // Ticks left in the current wave
+static uint32_t spawn_wait; // Ticks to the next enemy launch
+static uint32_t plane_wait; // Idle ticks left before the plane flies
+
+
+// Start the attack with the first of n waves. The last wave lasts until
+// the game ends, whatever its length.
+// waves: array of n waves, kept by reference.
+// n: number of waves, at least one.
+void wave_init(const wave_t *waves, uint32_t n)
+{
+	wave = waves;
+	wave_last = waves + n - 1;
+	wave_idx = 0;
+	wave_ticks = wave->ticks;
+	spawn_wait = 0;
+	plane_wait = wave->plane_ticks;
+}
+
+// Advance the attack by one tick: move to the next wave when it is due,
+// launch the enemy missiles that are due and the plane when its idle
+// time is over. Call after missiles_tick() in each tick.
+void wave_tick(void)
+{
+	missile_t m;
+
+	if (wave != wave_last && --wave_ticks == 0) {
+		wave++;
+		wave_idx++;
+		wave_ticks = wave->ticks;
+		if (spawn_wait > wave->spawn_ticks) spawn_wait = wave->spawn_ticks;
+	}
+
+	if (spawn_wait > 0) spawn_wait--;
+	while (spawn_wait == 0 &&
+			missiles_count(MISSILE_TYPE_ENEMY) < wave->enemies &&
+			missile_alloc(&m)) {
+		missile_init_enemy(&m);
+		spawn_wait = wave->spawn_ticks;
+	}
+
+	if (plane_is_flying()) {
+		plane_wait = wave->plane_ticks;
+	} else if (plane_wait == 0) {
+		plane_launch();
+	} else {
+		plane_wait--;
+	}
+}
+
+// Return the number of the current wave, from zero.
+uint32_t wave_number(void)
+{
+	return wave_idx;
+}
@@ -0,0 +1,34 @@
+#ifndef WAVE_H_
+#define WAVE_H_
+
+#include <stdint.h>
+
+// Scheduling of the attack in waves. Each wave sets how many enemy
+// missiles are in flight, how fast they are launched and how often the
+// plane flies, so the difficulty rises over time. Missiles are taken
+// from the pool with missile_alloc() only when one is due, instead of
+// scanning for idle missiles each tick.
+
+// One wave of the attack, times in ticks.
+typedef struct {
+	uint32_t ticks;       // Length of the wave, zero for until the game ends
+	uint16_t enemies;     // Enemy missiles in flight
+	uint16_t spawn_ticks; // Time between enemy launches, zero for at once
+	uint16_t plane_ticks; // Time the plane is idle between flights
+} wave_t;
+
+// Start the attack with the first of n waves. The last wave lasts until
+// the game ends, whatever its length.
+// waves: array of n waves, kept by reference.
+// n: number of waves, at least one.
+void wave_init(const wave_t *waves, uint32_t n);
+
+// Advance the attack by one tick: move to the next wave when it is due,
+// launch the enemy missiles that are due and the plane when its idle
+// time is over. Call after missiles_tick() in each tick.
+void wave_tick(void);
+
+// Return the number of the current wave, from zero.
+uint32_t wave_number(void);
+
+#endif // WAVE_H_
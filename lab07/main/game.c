@@ -1,7 +1,7 @@
 #include "game.h"
 #include "nav.h"
 #include "board.h"
-#include "pin.h"
+#include "buttons.h"
 #include "hw.h"
 #include "graphics.h"
 #include "lcd.h"
@@ -33,6 +33,8 @@ void game_init(void) {
 
 // Update the game logic.
 void game_tick(void) {
+    uint64_t press = buttons_pressed(); // Buttons pressed since last tick
+
     // state transitions
     switch(state) {
         case init_st:
@@ -44,7 +46,7 @@ void game_tick(void) {
         case choose_player_st:
             uint8_t sel_buffer[1];
             // Wait for a mark (Button A press) from a player
-            if (!pin_get_level(HW_BTN_A)) {
+            if (press & 1LLU << HW_BTN_A) {
                 player_red = true;
                 com_write(&player_red, 1);
                 state = new_game_st;
@@ -63,7 +65,7 @@ void game_tick(void) {
             uint8_t buffer[1];
             // Wait for a mark (Button A press) from a player
             if ((player_red && red_turn) || (!player_red && !red_turn)) {
-                if (!pin_get_level(HW_BTN_A)) {
+                if (press & 1LLU << HW_BTN_A) {
                     // Get the navigator location
                     nav_get_loc(&r, &c);
                     // Check if the column is valid
@@ -128,7 +130,7 @@ void game_tick(void) {
             break;
         case wait_restart_st:
             // Wait for a restart (Start Button press)
-            if (!pin_get_level(HW_BTN_START)) {
+            if (press & 1LLU << HW_BTN_START) {
                 // notify other player to restart the game
                 uint8_t restart = 0xFF;
                 com_write(&restart, 1);
@@ -8,12 +8,13 @@
 static const char *TAG = "lab07";
 
 #include "hw.h"
-#include "pin.h"
+#include "buttons.h"
 #include "lcd.h"
 #include "nav.h"
 #include "com.h"
 #include "graphics.h"
 #include "game.h"
+#include "prof.h"
 #include "config.h"
 
 // The update period as an integer in ms
@@ -21,25 +22,25 @@ static const char *TAG = "lab07";
 #define TIME_OUT 500 // ms
 
 TimerHandle_t update_timer; // Declare timer handle for update callback
-
-volatile bool interrupt_flag;
+TaskHandle_t game_task; // Task woken by the update timer
 
 uint32_t isr_triggered_count;
 uint32_t isr_handled_count;
 
-// Interrupt handler for game - use flag method
+// Interrupt handler for game - wake the game task
 void update() {
-	interrupt_flag = true;
 	isr_triggered_count++;
+	xTaskNotifyGive(game_task);
 }
 
 // Main application
 void app_main(void)
 {
-	// ISR flag and counts
-	interrupt_flag = false;
+	// ISR counts
 	isr_triggered_count = 0;
 	isr_handled_count = 0;
+	game_task = xTaskGetCurrentTaskHandle();
+	prof_init(PER_MS*1000);
 
 	// Initialization
 	lcd_init();
@@ -49,18 +50,7 @@ void app_main(void)
 	game_init();
 
 	// Configure I/O pins for buttons
-	pin_reset(HW_BTN_A);
-	pin_input(HW_BTN_A, true);
-	pin_reset(HW_BTN_B);
-	pin_input(HW_BTN_B, true);
-	pin_reset(HW_BTN_MENU);
-	pin_input(HW_BTN_MENU, true);
-	pin_reset(HW_BTN_OPTION);
-	pin_input(HW_BTN_OPTION, true);
-	pin_reset(HW_BTN_SELECT);
-	pin_input(HW_BTN_SELECT, true);
-	pin_reset(HW_BTN_START);
-	pin_input(HW_BTN_START, true);
+	buttons_init(HW_BTN_MASK);
 
 	// Initialize update timer
 	update_timer = xTimerCreate(
@@ -79,18 +69,19 @@ void app_main(void)
 		return;
 	}
 
-	// Main game loop
-	uint64_t t1, t2, tmax = 0; // For hardware timer values
+	// Main game loop, the task sleeps until the update timer wakes it.
+	// Ticks that are missed while a tick runs long are dropped.
 	int8_t r, c; // For navigator location
-	while (pin_get_level(HW_BTN_MENU)) // while MENU button not pressed
+	while (!(buttons_state() & 1LLU << HW_BTN_MENU)) // while MENU button not pressed
 	{
-		while (!interrupt_flag) ;
-		t1 = esp_timer_get_time();
-		interrupt_flag = false;
+		ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+		prof_frame_begin();
 		isr_handled_count++;
 
 		game_tick();
+		prof_mark(PROF_SIMULATE);
 		nav_tick();
+		prof_mark(PROF_INPUT);
 		if (started()) {
 			nav_get_loc(&r, &c);
 			static int8_t lr = -1, lc = -1;
@@ -100,10 +91,10 @@ void app_main(void)
 			}
 			graphics_drawHighlight(c, CONFIG_HIGH_CLR);
 		}
-		t2 = esp_timer_get_time() - t1;
-		if (t2 > tmax) tmax = t2;
+		prof_mark(PROF_RENDER);
+		prof_frame_end(); // Drawing is direct, no flush
 	}
 	printf("Handled %lu of %lu interrupts\n", isr_handled_count, isr_triggered_count);
-	printf("WCET us:%llu\n", tmax);
+	prof_print();
 }
 